@@ -0,0 +1,190 @@
+/*
+ * @@@Array operations.
+ * License: AGL, see LICENSE file for details.
+ */
+
+#ifndef ma_array_h
+#define ma_array_h
+
+#include "ma_conf.h"
+#include "ma_limits.h"
+#include "ma_val.h"
+
+/*
+ * ##Data-parallel operations.
+ *
+ * 'map', 'grep', 'uniq', 'sort', 'min'/'max'/'minmax' and other
+ * reductions of an Array of at least MA_PARMIN elements are split
+ * into chunks run on the OS threads of the scheduler when their
+ * callback is pure (FN_PURE, found by the compiler) or when the
+ * user asked for it with '.par' ('a.par.map(...)'). '.par' returns
+ * an 'Array::Par' view, an instance of a built-in class holding
+ * the Array, it never flags the Array itself. The Array is cut
+ * into chunks of MA_PARCHUNK elements, taken in turn through @next
+ * by the caller and up to one chunk maatine per other OS thread,
+ * and the caller waits on a single counter, the way 'Work.allof'
+ * does.
+ *
+ * Objects a chunk allocates (results of the callback, grep and
+ * uniq buffers) are owned by its maatine. A chunk maatine only
+ * runs chunks of the job, so all its pages hold objects of the job
+ * or garbage: once every chunk is done, the caller takes their pages
+ * whole with 'page_give()' and splices their object lists into its
+ * young generation, garbage included which its next cycle sweeps.
+ * Nothing is copied and @dst, @parts and what they reference are
+ * owned by the caller when it resumes, see "Channels" in
+ * 'docs/gc.md'.
+ *
+ * Chunk boundaries only depend on the size of the Array, so results
+ * don't depend on the number of threads nor on timing:
+ * - map: chunk 'i' writes the slots of its elements in the result.
+ * - grep: each chunk keeps its elements in a local buffer, the
+ *   buffers are concatenated in chunk order.
+ * - uniq: each chunk removes duplicates locally, keeping first
+ *   occurrences, then a sequential pass over the chunk results in
+ *   order keeps the first occurrence of each element.
+ * - sort: each chunk is sorted then chunks are merged pairwise in
+ *   parallel, merges are stable so equal elements keep their order.
+ * - reductions: chunks reduce their elements, then chunk results
+ *   are reduced in chunk order, so a non commutative callback still
+ *   gets its elements in order. Elements are grouped by chunk
+ *   rather than reduced left to right though, so the callback of a
+ *   parallel reduction must be associative; the built-in 'min',
+ *   'max' and 'minmax' are.
+ */
+
+/*
+ * @@ParJob: A data-parallel operation over an Array.
+ *
+ * - @src: The Array operated on, it's marked shared while the job
+ *   runs and read only by the chunks.
+ * - @fn: The callback, NULL for built-in comparisons.
+ * - @dst: The result Array, pre-sized for map and sort.
+ * - @parts: Per chunk results of grep, uniq and reductions, the
+ *   slot of a chunk which throws holds its exception instead, for
+ *   every operation.
+ * - @nchunks: Number of chunks, the size of @src divided by
+ *   MA_PARCHUNK rounded up.
+ * - @next: Index of the next chunk to run, taken with a fetch and
+ *   add by the caller and the chunk maatines.
+ * - @left: Chunks not done yet, the last one wakes the caller.
+ * - @errat: Index of the lowest chunk which threw, @nchunks if
+ *   none. A chunk that throws stores its exception in its slot of
+ *   @parts then lowers @errat with a CAS loop, so whatever the
+ *   order in which chunks finish, the caller rethrows the
+ *   exception of chunk @errat once all chunks are done. A chunk
+ *   taken with an index above @errat is skipped.
+ * - @op: The operation, one of 'PAR_*'.
+ */
+#define PAR_MAP     0
+#define PAR_GREP    1
+#define PAR_UNIQ    2
+#define PAR_SORT    3
+#define PAR_REDUCE  4
+
+typedef struct ParJob {
+   Array *src;
+   Closure *fn;
+   Array *dst;
+   Value *parts;
+   UInt nchunks;
+   AO_t next;
+   AO_t left;
+   AO_t errat;
+   UByte op;
+} ParJob;
+
+/*
+ * Whether an operation over 'a' with callback 'c' goes parallel,
+ * 'forced' when called on a '.par' view. An impure callback of a
+ * view must also have all of its captures flagged shared, see
+ * 'ma_par_shr()'.
+ */
+#define par_ok(a, c, forced)                                   \
+   ((a)->size >= MA_PARMIN                                     \
+    && ((c) == NULL || ((c)->fn->flags & FN_PURE)              \
+        || ((forced) && ma_par_shr(c))))
+
+/*
+ * Return 1 if every upvalue description of the closure 'c' has
+ * its @shr flag set; 0 otherwise.
+ */
+MA_IFUNC int ma_par_shr(Closure *c);
+
+/*
+ * Run 'job' across the scheduler's threads from maatine 'm', the
+ * caller takes chunks like the chunk maatines do then parks until
+ * @left is 0.
+ */
+MA_IFUNC void ma_par_run(struct Maa *m, ParJob *job);
+
+/*
+ * ##Sorting.
+ *
+ * Sorting an Array first scans it to see if it's homogeneous and
+ * then dispatches to a kernel that never calls into the VM:
+ * - Only numbers and a numeric order: LSD radix sort on keys made
+ *   from the bits of the numbers (see 'num2key()'), 8 passes of 8
+ *   bits over a scratch buffer, passes whose digit is the same for
+ *   every key are skipped. When Num isn't a double, pdqsort with a
+ *   native comparison is used instead.
+ * - Only strings and a stringwise order: multikey quicksort (three
+ *   way radix quicksort) over the string bytes, it compares each
+ *   byte of a common prefix once instead of once per comparison.
+ * - Anything else, or a user comparator closure: merge sort calling
+ *   the comparator, runs of MA_SORTRUN values are sorted with
+ *   binary insertion sort then merged bottom-up through a scratch
+ *   buffer, O(n log n) comparisons.
+ *
+ * Kernels sort an array of (key, index) pairs or of 'Value's in
+ * place, both are contiguous so their passes are sequential scans.
+ * 'sort' is stable: radix and merge sort are, pdqsort and multikey
+ * quicksort are only used where values comparing equal can't be
+ * told apart (canonical numbers, strings of the same bytes).
+ */
+#define SORT_NUM      0
+#define SORT_STR      1
+#define SORT_GENERIC  2
+
+/*
+ * Order preserving map from the bits of a double to an unsigned 64
+ * bits key: flip all the bits of negative numbers and the sign bit
+ * of the others. 'num2key()' expects canonical bits: -0.0 compares
+ * equal to 0.0 and NaNs have many encodings, some with the sign bit
+ * set, so 'numcanon()' turns -0.0 into 0.0 and every NaN into the
+ * positive quiet NaN first. NaNs then end up after +inf.
+ */
+#define NUM_QNAN  0x7ff8000000000000ull
+
+#define numcanon(bits)                                              \
+   (((bits) & 0x7fffffffffffffffull) > 0x7ff0000000000000ull        \
+    ? NUM_QNAN : (bits) == 0x8000000000000000ull ? 0 : (bits))
+
+#define num2key(bits)  \
+   ((bits) & 0x8000000000000000ull ? ~(bits) : (bits) | 0x8000000000000000ull)
+
+/*
+ * Return SORT_NUM or SORT_STR if the 'n' values of 'v' are all
+ * numbers or all strings, SORT_GENERIC otherwise.
+ */
+MA_IFUNC UByte ma_sort_kind(const Value *v, size_t n);
+
+/* Sort 'n' numbers of 'v' in place, 'tmp' has room for 'n' values. */
+MA_IFUNC void ma_sort_radix(Value *v, Value *tmp, size_t n, UByte desc);
+
+/* Sort 'n' strings of 'v' in place, bytewise. */
+MA_IFUNC void ma_sort_mkqs(Value *v, size_t n, UByte desc);
+
+/* Sort 'n' numbers of 'v' in place when Num isn't a double. */
+MA_IFUNC void ma_sort_pdq(Value *v, size_t n, UByte desc);
+
+/*
+ * Stable sort of the 'n' values of 'v' in place with the
+ * comparator closure 'cmp' called from maatine 'm', or with the
+ * default order of the values if 'cmp' is NULL. 'tmp' has room for
+ * 'n' values.
+ */
+MA_IFUNC void ma_sort_merge(struct Maa *m, Value *v, Value *tmp, size_t n,
+                            Closure *cmp);
+
+#endif
@@ -53,6 +53,24 @@
 #define MA_USE_DLOPEN
 #endif
 
+/*
+ * ##Define MA_USE_IOURING via "-D" on Linux with liburing to have
+ * the I/O reactor use io_uring, epoll is used otherwise.
+ */
+#if defined(MA_USE_IOURING) && !defined(MA_IN_LINUX)
+#undef MA_USE_IOURING
+#endif
+
+/*
+ * ##Readiness backend of the I/O reactor when io_uring isn't used:
+ * epoll on Linux, kqueue on MacOSX and iOS, poll() anywhere else.
+ */
+#if defined(MA_IN_LINUX)
+#define MA_USE_EPOLL
+#elif defined(MA_IN_MACOSX) || defined(MA_IN_IOS)
+#define MA_USE_KQUEUE
+#endif
+
 /*
  * ##Configuring dir separator and default paths for Maat and
  * external libs.
@@ -171,6 +189,22 @@
 #define MA_IFUNC  /* extern by default */
 #endif
 
+/*
+ * ##SIMD used by string searching and translation, detected from
+ * the compiler's target flags. Define MA_NOSIMD via "-D" to use
+ * portable code only.
+ */
+#if !defined(MA_NOSIMD)
+#if defined(__AVX2__)
+#define MA_USE_AVX2
+#define MA_USE_SSE2
+#elif defined(__SSE2__)
+#define MA_USE_SSE2
+#elif defined(__ARM_NEON)
+#define MA_USE_NEON
+#endif
+#endif
+
 /* ##Configs for inline functions. */
 #if defined(__GNUC__)
 #define ma_inline  __inline__
@@ -0,0 +1,62 @@
+/*
+ * @@@Seeded hashing of strings and Map keys.
+ * License: AGL, see LICENSE file for details.
+ */
+
+#ifndef ma_hash_h
+#define ma_hash_h
+
+#include <stdint.h>
+
+#include "ma_conf.h"
+#include "ma_limits.h"
+
+/*
+ * Strings are hashed with a wyhash class function keyed by
+ * @seed of GMaa, drawn at startup from the OS entropy source so
+ * that hashes can't be predicted from outside. Every byte of a
+ * string takes part in its hash, no sampling: sampling long strings
+ * makes crafting colliding keys trivial. Long strings (8 bytes at a
+ * time, 48 with SIMD) are hashed on first use only and the result
+ * is cached in @hash of the string (see 'is_hashed()' in
+ * 'ma_str.c'), short strings are hashed once when internalized.
+ *
+ * The state and constants are uint64_t rather than UMem, which is
+ * only 32 bits on 32-bit targets and would truncate the constants
+ * and make 'hs_fold()' shift by the width of its operand.
+ */
+
+/* 64x64 -> 128 bits multiply folded to 64 bits, the core of the mix. */
+#if defined(__SIZEOF_INT128__)
+#define hs_mum(a, b, r)                                         \
+   do {                                                         \
+      __uint128_t p_ = (__uint128_t)(a) * (b);                  \
+      (r) = (uint64_t)(p_ >> 64) ^ (uint64_t)p_;                \
+   } while (0)
+#else
+#define hs_mum(a, b, r)  ((r) = ma_hs_mum(a, b))
+MA_IFUNC uint64_t ma_hs_mum(uint64_t a, uint64_t b);
+#endif
+
+#define HS_P0  UINT64_C(0xa0761d6478bd642f)
+#define HS_P1  UINT64_C(0xe7037ed1a0b428db)
+
+/*
+ * Mixer for integer and float keys of a Map: a single multiply
+ * folding of the key with the seed, every bit of the key affects
+ * every bit of the result. Float keys are hashed by their bits
+ * after -0.0 is turned into 0.0, integral floats are integer keys.
+ */
+ma_sinline uint64_t ma_hash_int(uint64_t k, uint64_t seed) {
+   uint64_t r;
+   hs_mum(k ^ HS_P0, seed ^ HS_P1, r);
+   return r;
+}
+
+/* Hash 'len' bytes of 's' with 'seed'. */
+MA_IFUNC uint64_t ma_hash_bytes(const Byte *s, size_t len, uint64_t seed);
+
+/* Fold a 64 bits hash into the @hash field of a Str. */
+#define hs_fold(h)  cast(UInt, cast(uint64_t, h) ^ (cast(uint64_t, h) >> 32))
+
+#endif
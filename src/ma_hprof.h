@@ -0,0 +1,165 @@
+/*
+ * @@@Heap profiler, see "Heap Profiling" in 'docs/gc.md'.
+ * License: AGL, see LICENSE file for details.
+ */
+
+#ifndef ma_hprof_h
+#define ma_hprof_h
+
+#include "ma_conf.h"
+#include "ma_limits.h"
+#include "ma_val.h"
+
+/* Set in the @mark of an object whose allocation was sampled. */
+#define HPROF_BIT       (0b1 << 6)
+#define is_sampled(o)   ((o)->mark & HPROF_BIT)
+#define set_sampled(o)  ((o)->mark |= HPROF_BIT)
+#define clr_sampled(o)  ((o)->mark &= cast(UByte, ~HPROF_BIT))
+
+/*
+ * @@HPSample: A sampled allocation.
+ *
+ * - @o: The sampled object, NULL once freed.
+ * - @fn: Function which allocated @o, NULL if it's C code.
+ * - @pc: Offset of the allocating instruction in the bytecode of
+ *   @fn.
+ * - @size: Size of @o at allocation.
+ * - @weight: Number of bytes this sample stands for, i.e the
+ *   sampling interval when @o was sampled.
+ * - @type: Type of @o with its variant.
+ */
+typedef struct HPSample {
+   Object *o;
+   Fn *fn;
+   UInt pc;
+   size_t size;
+   size_t weight;
+   UByte type;
+} HPSample;
+
+/*
+ * @@HProf: Heap profile of a maatine, only allocated when heap
+ * profiling is on.
+ *
+ * - @rate: Mean number of bytes between two samples.
+ * - @next: Bytes to allocate before the next sample, drawn from
+ *   an exponential distribution of mean @rate so that every byte
+ *   has the same chance of being sampled.
+ * - @nobj, @bytes: Live objects and bytes per base type, exact
+ *   once every batch freed by a sweeper is merged (see @@HPDelta)
+ *   and every object handed over to this maatine is adopted.
+ * - @samples: Buffer of @nsamples live samples out of @cap.
+ */
+typedef struct HProf {
+   size_t rate;
+   Mem next;
+   UMem nobj[O_NTYPES];
+   UMem bytes[O_NTYPES];
+   HPSample *samples;
+   UInt nsamples;
+   UInt cap;
+} HProf;
+
+/*
+ * Account the allocation of 'o' of 'size' bytes in the profile
+ * 'hp' of a maatine, the slow path is only taken when sampling.
+ */
+#define hprof_alloc(m, hp, o, size)                         \
+   do {                                                     \
+      (hp)->nobj[without_variant(o)]++;                     \
+      (hp)->bytes[without_variant(o)] += (size);            \
+      if (ma_unlikely(((hp)->next -= (size)) < 0))          \
+         ma_hprof_sample(m, o, size);                       \
+   } while (0)
+
+/* Account the freeing of 'o' of 'size' bytes by the maatine. */
+#define hprof_free(m, hp, o, size)                          \
+   do {                                                     \
+      (hp)->nobj[without_variant(o)]--;                     \
+      (hp)->bytes[without_variant(o)] -= (size);            \
+      if (ma_unlikely(is_sampled(o)))                       \
+         ma_hprof_unsample(m, o);                           \
+   } while (0)
+
+/*
+ * Account 'o' of 'size' bytes leaving the maatine, either pushed
+ * to the @adopted stack of its new owner or evacuated, right
+ * before it's pushed or overwritten by its forwarding stub. Its
+ * sample is dropped: a sample stays with the profile of the
+ * maatine which took it, the receiver accounts 'o' with
+ * 'hprof_adopt()' and never samples it. The stub left behind is
+ * not accounted when it's freed.
+ */
+#define hprof_give(m, hp, o, size)                          \
+   do {                                                     \
+      hprof_free(m, hp, o, size);                           \
+      clr_sampled(o);                                       \
+   } while (0)
+
+/* Account 'o' of 'size' bytes spliced from @adopted into @old. */
+#define hprof_adopt(hp, o, size)                            \
+   do {                                                     \
+      (hp)->nobj[without_variant(o)]++;                     \
+      (hp)->bytes[without_variant(o)] += (size);            \
+   } while (0)
+
+/*
+ * @@HPDelta: Frees of a batch swept by a background sweeper, see
+ * "Background Sweeping" in 'docs/gc.md'. A sweeper never touches
+ * the @@HProf of the maatine, it accounts frees in the delta that
+ * travels with the batch on @freed and the maatine merges it with
+ * 'ma_hprof_merge()' when it takes the batch back, before any of
+ * its memory can be reused.
+ *
+ * - @nobj, @bytes: Freed objects and bytes per base type.
+ * - @unsampled: The @nunsampled sampled objects of the batch out
+ *   of @cap, only compared against the @o of the samples, never
+ *   dereferenced.
+ */
+typedef struct HPDelta {
+   UMem nobj[O_NTYPES];
+   UMem bytes[O_NTYPES];
+   Object **unsampled;
+   UInt nunsampled;
+   UInt cap;
+} HPDelta;
+
+/* Account the freeing of 'o' of 'size' bytes by a sweeper. */
+#define hpd_free(d, o, size)                                \
+   do {                                                     \
+      (d)->nobj[without_variant(o)]++;                      \
+      (d)->bytes[without_variant(o)] += (size);             \
+      if (ma_unlikely(is_sampled(o)))                       \
+         ma_hpd_unsample(d, o);                             \
+   } while (0)
+
+/* Remember the sampled object 'o' freed in the batch of 'd'. */
+MA_IFUNC void ma_hpd_unsample(HPDelta *d, Object *o);
+
+/* Apply the delta 'd' of a batch taken back to the profile of 'm'. */
+MA_IFUNC void ma_hprof_merge(struct Maa *m, HPDelta *d);
+
+/*
+ * Record 'o' as a sample with the 'Fn' and 'pc' of the running
+ * callframe of 'm', then draw the next sampling point.
+ */
+MA_IFUNC void ma_hprof_sample(struct Maa *m, Object *o, size_t size);
+
+/* Drop the sample of the freed object 'o'. */
+MA_IFUNC void ma_hprof_unsample(struct Maa *m, Object *o);
+
+/*
+ * Add the counts and samples of the profile of 'from' to that of
+ * 'm' which took every page of 'from' whole, as a '.par' caller
+ * does with its chunk maatines. Objects don't move so samples
+ * stay valid.
+ */
+MA_IFUNC void ma_hprof_take(struct Maa *m, struct Maa *from);
+
+/*
+ * Dump a snapshot of the heap as seen from maatine 'm' into the
+ * file 'path' in the JSON format documented in 'docs/gc.md'.
+ */
+MA_API int ma_hprof_dump(struct Maa *m, const char *path);
+
+#endif
@@ -0,0 +1,136 @@
+/*
+ * @@@Non-blocking I/O reactor of an MVM for Socket, File, Pipe,
+ * Proc and Dir.
+ * License: AGL, see LICENSE file for details.
+ */
+
+#ifndef ma_io_h
+#define ma_io_h
+
+#include <stdint.h>
+#include "ma_conf.h"
+#include "ma_limits.h"
+#include "ma_val.h"
+
+/*
+ * Each MVM has a reactor. A maatine doing I/O that would block
+ * (read on an empty socket or pipe, write on a full one, accept,
+ * connect, waiting for a child process) doesn't block the OS
+ * thread: the operation is submitted to the reactor, it returns a
+ * Work and the maatine parks on it just like 'abide' does, so the
+ * scheduler runs other maatines meanwhile. When the reactor finds
+ * the operation ready or completed, the Work is Done with its
+ * result and the maatine is scheduled again. The same Work is what
+ * 'Socket::Work' and 'Proc::Work' expose to Maat code.
+ *
+ * The backend is io_uring when maat is built with MA_USE_IOURING
+ * and the kernel supports it (completion based, the operation
+ * itself is done by the kernel). Otherwise it is readiness based,
+ * the operation is retried once the fd is ready: epoll on Linux,
+ * kqueue on MacOSX and iOS (where IO_WAITPID waits on the pid with
+ * EVFILT_PROC instead of a pidfd) and poll() elsewhere, see
+ * MA_USE_EPOLL and MA_USE_KQUEUE. Regular files are always ready
+ * for a readiness backend, so without io_uring their I/O is done
+ * on a helper thread of the MVM.
+ *
+ * Buffers of in-flight operations are pinned: an operation keeps
+ * the object owning its buffer in @pin and the reactor is a root
+ * of the collectors, so the buffer outlives the operation even if
+ * its Work is dropped. With io_uring the kernel writes into it
+ * while no maatine runs, so a cancelled operation keeps its pin
+ * until the completion of the cancel is reaped, and a channel send
+ * whose graph holds a pinned object parks until it is unpinned
+ * rather than evacuating it, see "Channels" in 'docs/gc.md'.
+ */
+#define IO_EPOLL    0
+#define IO_URING    1
+#define IO_KQUEUE   2
+#define IO_POLL     3
+
+/* Operations a maatine can park on. */
+#define IO_READ     0
+#define IO_WRITE    1
+#define IO_ACCEPT   2
+#define IO_CONNECT  3
+#define IO_WAITPID  4
+
+/*
+ * @@IOOp: A pending operation, allocated from the free list of the
+ * reactor and never by the maatine submitting it.
+ *
+ * - @wk: The Work completed when the operation is done.
+ * - @fd: The file descriptor or for IO_WAITPID a pidfd, or the
+ *   pid itself with kqueue.
+ * - @buf, @len: Buffer of a read/write and its length.
+ * - @pin: The object owning @buf, kept alive and never moved
+ *   while the operation is in flight.
+ * - @res: Result of the operation, bytes transferred, accepted fd,
+ *   or a negated errno.
+ * - @op: One of 'IO_*'.
+ * - @next: Next free operation, or next operation waiting on the
+ *   same fd with epoll.
+ */
+typedef struct IOOp {
+   struct Work *wk;
+   Int fd;
+   Byte *buf;
+   size_t len;
+   Object *pin;
+   long res;
+   UByte op;
+   struct IOOp *next;
+} IOOp;
+
+/*
+ * @@Reactor: The I/O reactor of an MVM.
+ *
+ * - @backend: One of 'IO_*' backends.
+ * - @fd: The epoll, kqueue or io_uring fd, -1 with poll().
+ * - @ring: io_uring submission/completion rings, NULL otherwise.
+ * - @waiting: With a readiness backend, operations parked per fd,
+ *   indexed by fd.
+ * - @wcap: Capacity of @waiting.
+ * - @pfds: With poll(), the @npfds fds having parked operations,
+ *   NULL otherwise.
+ * - @npending: Number of operations in flight, the scheduler
+ *   thread only blocks in the reactor when it has no maatine to
+ *   run and @npending isn't 0.
+ * - @free: Free list of operations.
+ */
+typedef struct Reactor {
+   UByte backend;
+   Int fd;
+   void *ring;
+   IOOp **waiting;
+   size_t wcap;
+   struct pollfd *pfds;
+   size_t npfds;
+   size_t npending;
+   IOOp *free;
+} Reactor;
+
+/*
+ * Initialize 'io', using io_uring if available, the readiness
+ * backend of the platform otherwise.
+ */
+MA_IFUNC int ma_io_init(Reactor *io);
+
+/*
+ * Submit operation 'op' of the running maatine of 'm' and return
+ * the Work it parks on. 'pin' is the object owning 'buf', NULL if
+ * there is none. With a readiness backend, the operation is first
+ * tried right away and the returned Work is already Done if it
+ * didn't have to wait.
+ */
+MA_IFUNC struct Work *ma_io_submit(struct Maa *m, Reactor *io, UByte op, Int fd,
+                                   Byte *buf, size_t len, Object *pin);
+
+/*
+ * Complete the Works of ready operations, waiting at most
+ * 'timeout' ns (0 to poll, the next timer deadline when idle) on
+ * 64 bits like the times of 'ma_timer.h'. Return the number of
+ * Works completed.
+ */
+MA_IFUNC int ma_io_poll(Reactor *io, uint64_t timeout);
+
+#endif
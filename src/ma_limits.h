@@ -10,4 +10,143 @@
 
 #define MAX_SIZE  (size_t)(~(size_t)0)
 
+/*
+ * Initial number of value slots and callframes of a State, kept
+ * small so that coroutines and generators are cheap to create.
+ */
+#if !defined(MA_MINSTACK)
+#define MA_MINSTACK  20
+#endif
+
+#if !defined(MA_MINCSTK)
+#define MA_MINCSTK  4
+#endif
+
+/* Slots kept past the usable part of a stack. */
+#define MA_EXTRASTACK  5
+
+/*
+ * Number of captures ('#&' included) whose offsets are kept inline
+ * in a special variables record, others are spilled.
+ */
+#if !defined(MA_SVNCAP)
+#define MA_SVNCAP  10
+#endif
+
+/*
+ * Number of failed attempts to take the lock of a shared upvalue
+ * or global before the maatine parks, see 'sl_lock()'.
+ */
+#if !defined(MA_SLSPIN)
+#define MA_SLSPIN  64
+#endif
+
+/*
+ * Number of slots covered by a card and minimum number of slots for
+ * an Array or Map buffer to get a card table.
+ */
+#if !defined(MA_CARDSIZE)
+#define MA_CARDSIZE  128
+#endif
+
+#define MA_CARDMIN  (8 * MA_CARDSIZE)
+
+/*
+ * Size of a page objects are allocated from, it must be a power of
+ * 2, and size of the largest object allocated within a page.
+ */
+#if !defined(MA_PAGESIZE)
+#define MA_PAGESIZE  (64 * 1024)
+#endif
+
+#define MA_PAGEMAX  (MA_PAGESIZE / 4)
+
+/* Default length limit of the queue of objects to finalize of a maatine. */
+#if !defined(MA_FINQMAX)
+#define MA_FINQMAX  4096
+#endif
+
+/* Default mean number of bytes between two heap profile samples. */
+#if !defined(MA_HPRATE)
+#define MA_HPRATE  (512 * 1024)
+#endif
+
+/* Bytes a maatine reserves at a time from the quota of its group. */
+#if !defined(MA_QUOTACHUNK)
+#define MA_QUOTACHUNK  (256 * 1024)
+#endif
+
+/*
+ * Timing wheel of the scheduler: duration of a tick in ns, slots
+ * per level and number of levels (64^6 ticks of 1ms covers more
+ * than 2 years, longer delays are clamped and re-armed).
+ */
+#if !defined(MA_TWTICK)
+#define MA_TWTICK  1000000
+#endif
+
+#define MA_TWSLOTS  64
+#define MA_TWLEVELS  6
+
+/* Number of dependents of a Work kept inline. */
+#if !defined(MA_WKDEPS)
+#define MA_WKDEPS  2
+#endif
+
+/*
+ * Cache of runtime-built regexes: number of sets, a power of 2, and
+ * of entries per set.
+ */
+#if !defined(MA_RXSETS)
+#define MA_RXSETS  256
+#endif
+
+#define MA_RXWAYS  4
+
+/* Maximum length of the required literal of a regex prefilter. */
+#define MA_RXLITMAX  255
+
+/*
+ * Cache of C API snippets: number of sets, a power of 2, and of
+ * entries per set.
+ */
+#if !defined(MA_SNIPSETS)
+#define MA_SNIPSETS  128
+#endif
+
+#define MA_SNIPWAYS  4
+
+/*
+ * Minimum size of an Array for its operations to run in parallel
+ * and number of elements of a chunk, the last chunk may be
+ * shorter. Chunk boundaries only depend on the size of the Array.
+ */
+#if !defined(MA_PARMIN)
+#define MA_PARMIN  (64 * 1024)
+#endif
+
+#define MA_PARCHUNK  (MA_PARMIN / 4)
+
+/* Length of the runs sorted by insertion before merging. */
+#define MA_SORTRUN  32
+
+/*
+ * Sampling profiler: default frequency in Hz, max frames kept per
+ * sample and samples buffered per MVM.
+ */
+#if !defined(MA_PROFHZ)
+#define MA_PROFHZ  1000
+#endif
+
+#define MA_PROFDEPTH  64
+#define MA_PROFBUF    1024
+
+/* Number of buckets of the GC step duration histogram of a Maa. */
+#define MA_GCHIST  16
+
+/* Maximum number of value slots of a State. */
+#if !defined(MA_MAXSTACK)
+#define MA_MAXSTACK  1000000
+#endif
+
 #endif
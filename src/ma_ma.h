@@ -1,8 +1,12 @@
 #ifndef ma_ma_h
 #define ma_ma_h
 
+#include <stdint.h>
+
 #include "ma_val.h"
 #include "ma_state.h"
+#include "ma_regex.h"
+#include "ma_snip.h"
 
 /* @@Map of short strings @map, it has size @size, capacity @cap. */
 typedef struct SMap {
@@ -11,13 +15,33 @@ typedef struct SMap {
    Str **map;
 } SMap;
 
+/*
+ * @@MGroup: A group of maatines sharing a memory quota, see
+ * "Memory Quotas" in 'docs/gc.md'.
+ *
+ * - @mem: Bytes reserved by the maatines of the group, maatines
+ *   reserve MA_QUOTACHUNK bytes at a time so this is only updated
+ *   once every MA_QUOTACHUNK bytes allocated.
+ * - @soft: Past it, maatines of the group do emergency cycles.
+ * - @hard: Past it, an allocating maatine of the group raises a
+ *   memory exception. 0 means no limit for both.
+ */
+typedef struct MGroup {
+   AO_t mem;
+   UMem soft;
+   UMem hard;
+} MGroup;
+
 /*
  * @@Data common to all Maatines, mutex must be used for some
  * of these variables.
  */
 typedef struct GMaa {
-   /* @seed: Random seed for Maps. */
-   UInt seed;
+   /*
+    * @seed: Random seed of the string and Map key hash functions,
+    * see 'ma_hash.h'.
+    */
+   uint64_t seed;
 
    /*
     * @scache: Caching strings, it needs sync as it's shared across
@@ -26,11 +50,6 @@ typedef struct GMaa {
    MStr scache[M_SCACHE][N_SCACHE];
    /* TODO: librs fields */
 
-   /*
-    * A Map to cache the visual length utf-8 strings, do not forget
-    * to delete entries of strings whose memory were reclaimed.
-    */
-   Map vlcache;
    /* TODO: librs fields */
 
    /*
@@ -46,14 +65,48 @@ typedef struct GMaa {
     * so that each namespace has a unique index.
     * @ns_buf: A buffer of namespaces, since ns resolution is done
     * at compile time, each namespace is accessible here via a
-    * unique index and hence zero collision at runtime.
+    * unique index and hence zero collision at runtime. The same
+    * goes for the global symbols of a namespace, see @@GSlot.
     */
    Map *ns_names;
    NamespaceBuf nsbuf;
 
+   /* @rxcache: Cache of regexes built at runtime. */
+   RXCache rxcache;
+
+   /* @snips: Cache of the snippets of the C API, see 'ma_snip.h'. */
+   SnipCache snips;
+
    /* Linked-list of shared objects. */
    Object *lso;
 
+   /*
+    * LSO epochs, see "Background Sweeping" in 'docs/gc.md'.
+    *
+    * - @gc_epoch: Current GC epoch in the upper half and number of
+    *   maatines counted in it in the lower half, see 'ep_pack()'.
+    *   The epoch advances once every live maatine has passed the
+    *   atomic phase of a cycle in it.
+    * - @nmaa: Number of live maatines.
+    */
+   AO_t gc_epoch;
+   AO_t nmaa;
+
+   /*
+    * - @sweepq: Queue of maatines whose old generation and LSO are
+    *   waiting for a sweeper thread.
+    * - @nsweepers: Number of background sweeper threads.
+    */
+   struct Rbq *sweepq;
+   UByte nsweepers;
+
+   /*
+    * @finq_max: Length of the @finq of a maatine past which its
+    * collector stops queueing and its allocations run @finco, see
+    * "Finalizers" in 'docs/gc.md'.
+    */
+   UInt finq_max;
+
 } GMaa;
 
 /*
@@ -78,6 +131,20 @@ typedef struct Maa {
    /* @co: Pointer to the first coroutine of this Maatine. */
    State *co;
 
+   /*
+    * @running: The state currently running on this Maatine, either
+    * @state or a coroutine/Gfun, resume and yield simply swap it,
+    * see 'co_resume()' and 'co_yield()'.
+    */
+   State *running;
+
+   /*
+    * @xfer: Transfer slot reused by every 'for' loop iteration over
+    * a generator, the yielded value lands here and is copied into
+    * the loop's topic variable directly.
+    */
+   Value xfer;
+
    /* @mvm: An instance of a VM this Maatine is attached to. */
    struct MVM *mvm;
 
@@ -85,6 +152,23 @@ typedef struct Maa {
    UMem mem;
    UMem estimate;
 
+   /*
+    * Memory quotas, 0 means no limit. The debt is clamped to get
+    * positive no later than the smaller limit set, and the slow
+    * path checks them against @mem + @debt plus the size of the
+    * pending allocation.
+    *
+    * - @mem_soft: Past it, this maatine does an emergency cycle.
+    * - @mem_hard: Past it even after an emergency cycle, an
+    *   allocation raises a memory exception in this maatine only.
+    * - @grp: Group of this maatine, NULL if it has none.
+    * - @grp_resv: Bytes reserved from @grp not used yet.
+    */
+   UMem mem_soft;
+   UMem mem_hard;
+   MGroup *grp;
+   UMem grp_resv;
+
    /*
     * @gc_fgcc:
     *   Controls whether the maatine has done its first GC cycle
@@ -101,6 +185,32 @@ typedef struct Maa {
    UByte gc_minor;
    UByte gc_major;
 
+   /*
+    * Pause-time pacing, see "Pause-Time Pacing" in 'docs/gc.md'.
+    *
+    * - @gc_pacing: 1 if steps are paced by @gc_maxpause; 0 if they
+    *   are paced by @gc_ssize and @gc_smul.
+    * - @gc_cpu: CPU budget of the collector, in percent of the time
+    *   of this maatine, within 1..99.
+    * - @gc_maxpause: Target maximum duration of a step, in µs.
+    * - @gc_pspw: Measured cost of a unit of work in ps, a moving
+    *   average updated at the end of each step, never below 1.
+    * - @gc_lastend: Monotonic time in ns at which the last step
+    *   ended.
+    * - @gc_hist: Histogram of step durations, see 'gc_histbucket()'.
+    *
+    * @gc_maxpause, @gc_pspw and @gc_lastend are 64 bits whatever
+    * the target: the budget of a step is @gc_maxpause * 10^6 /
+    * @gc_pspw, which overflows 32 bits past a target of 4.29 ms,
+    * and times in ns wrap 32 bits every 4.3 s.
+    */
+   UByte gc_pacing;
+   UByte gc_cpu;
+   uint64_t gc_maxpause;
+   uint64_t gc_pspw;
+   uint64_t gc_lastend;
+   UInt gc_hist[MA_GCHIST];
+
    Int ntmps;
    Object *tmproots;
    Object *mobj;
@@ -113,6 +223,100 @@ typedef struct Maa {
    Object *fin_old;
    Object *fin_old2;
 
+   /*
+    * Finalization, see "Finalizers" in 'docs/gc.md'.
+    *
+    * - @tobefin: Unreachable finalizable objects waiting for @finq.
+    * - @finq: Objects whose destructor is to be called, roots of
+    *   this collector until @finco has run it.
+    * - @nfinq: Length of @finq.
+    * - @finco: Finalizer coroutine of this maatine, created on first
+    *   use and resumed by the scheduler outside of any GC step.
+    * - @fin_ndone: Number of destructors run by @finco so far.
+    * - @fin_emerg: @fin_ndone at the last emergency collection
+    *   triggered by a full @finq.
+    */
+   Object *tobefin;
+   Object *finq;
+   UInt nfinq;
+   State *finco;
+   UMem fin_ndone;
+   UMem fin_emerg;
+
+   /*
+    * @slices: String slices reached in this cycle, their parents
+    * are marked or compacted away after propagation.
+    */
+   Object *slices;
+
+   /*
+    * Weak Maps of this maatine to be cleared in the atomic phase.
+    *
+    * - @weak: Maps with weak values only.
+    * - @ephe: Ephemeron Maps and Maps with weak keys only.
+    * - @allweak: Maps with both weak keys and values.
+    */
+   Object *weak;
+   Object *ephe;
+   Object *allweak;
+
+   /*
+    * Background sweeping, see "Background Sweeping" in 'docs/gc.md'.
+    *
+    * - @gc_sweeping: 1 while a sweeper thread owns @old, @old2,
+    *   @fin_old and @fin_old2 of this maatine; 0 otherwise.
+    * - @old_pend: Objects migrated to the old generation while
+    *   @gc_sweeping is set, spliced into @old once it is cleared.
+    * - @freed: Lock-free stack of batches of memory freed by a
+    *   sweeper, handed back to the allocator of this maatine.
+    * - @freed_bytes: Bytes in @freed, subtracted from @debt when the
+    *   batches are taken back.
+    * - @lso_epoch: The last epoch this maatine was counted in, see
+    *   'ep_epoch()'.
+    * - @gc_parity: Value of the mark parity bit that reads as black,
+    *   flipped at the start of the mark phase of a major cycle.
+    */
+   AO_t gc_sweeping;
+   Object *old_pend;
+   AO_t freed;
+   AO_t freed_bytes;
+   AO_t lso_epoch;
+   UByte gc_parity;
+
+   /*
+    * @adopted: Lock-free stack of objects of pages moved to this
+    * maatine but still linked in the lists of their sender, pushed
+    * by the sender when it walks them and spliced into @old at the
+    * next GC step, see "Channels" in 'docs/gc.md'.
+    */
+   AO_t adopted;
+
+   /*
+    * - @evicted: Regexes this maatine evicted, see @@Evicted.
+    * - @snip_evicted: Snips this maatine evicted, see 'ma_snip.h'.
+    */
+   struct Evicted *evicted;
+   struct Snip *snip_evicted;
+
+   /*
+    * - @wk_tramp: Works completed inline waiting for their
+    *   dependents to be gone through, see 'ma_wk_complete()'.
+    * - @wk_completing: 1 while 'ma_wk_complete()' drains @wk_tramp.
+    */
+   struct Work *wk_tramp;
+   UByte wk_completing;
+
+   /*
+    * @vlcache: A Map with weak keys to cache the visual length of
+    * utf-8 strings, entries of strings whose memory were reclaimed
+    * are cleared by the collector. It is per Maatine since weak
+    * Maps can't be shared, see "Weak Maps" in 'docs/gc.md'.
+    */
+   Map vlcache;
+
+   /* @hprof: Heap profile of this Maatine, NULL unless enabled. */
+   struct HProf *hprof;
+
    /* @mma: Points to the main Maatine. */
    Ma *mma;
 
@@ -123,4 +327,32 @@ typedef struct Maa {
    GMa *gma;
 } Maa;
 
+/*
+ * Pack and unpack @gc_epoch of GMaa. On 32-bit targets the epoch
+ * wraps after 2^16 advances, epochs are compared by their masked
+ * difference so that's fine as long as no LSO batch waits that
+ * many epochs.
+ */
+#define EP_SHIFT  (sizeof(AO_t) * CHAR_BIT / 2)
+#define EP_MASK   ((cast(AO_t, 1) << EP_SHIFT) - 1)
+
+#define ep_pack(e, n)  ((cast(AO_t, e) << EP_SHIFT) | ((n) & EP_MASK))
+#define ep_epoch(w)    ((w) >> EP_SHIFT)
+#define ep_count(w)    ((w) & EP_MASK)
+
+/*
+ * Bucket of @gc_hist for a step that lasted 'us' µs, floor(log2(us))
+ * with steps under 2 µs (under 1 µs included) in bucket 0 and the
+ * last bucket taking every longer step.
+ */
+ma_sinline UInt gc_histbucket(UMem us) {
+   UInt i = 0;
+
+   while (us > 1 && i < MA_GCHIST - 1) {
+      us >>= 1;
+      i++;
+   }
+   return i;
+}
+
 #endif
@@ -0,0 +1,51 @@
+/*
+ * @@@Pages objects are allocated from.
+ * License: AGL, see LICENSE file for details.
+ */
+
+#ifndef ma_mem_h
+#define ma_mem_h
+
+#include "ma_conf.h"
+#include "ma_limits.h"
+#include "ma_val.h"
+
+/*
+ * @@Page: A maatine allocates its collectable objects from pages
+ * of MA_PAGESIZE bytes aligned on MA_PAGESIZE, objects larger than
+ * MA_PAGEMAX get a page of their own. Ownership of objects is
+ * tracked per page rather than per object, so that handing a
+ * graph of objects to another maatine through a channel rewrites
+ * one id per page instead of one per object, see "Channels" in
+ * 'docs/gc.md'. Objects sent from a page that does not move as a
+ * whole are copied out and leave a forwarding stub behind, a page
+ * thus never holds objects of another maatine. The objects of a
+ * moved page stay in the object lists of the sender until it
+ * walks them, it never frees an object whose @mid isn't its own
+ * and pushes it to the @adopted stack of its new owner instead.
+ *
+ * - @mid: The id of the maatine owning every object of the page.
+ * - @next: Next page of the owner in the same generation.
+ * - @nobj: Number of allocated (not yet freed) objects.
+ * - @nsend: Number of objects of the page found by the traversal
+ *   of the graph being sent, the page moves as a whole when
+ *   @nsend equals @nobj.
+ * - @size: Size of the page, MA_PAGESIZE unless it holds a single
+ *   large object.
+ */
+typedef struct Page {
+   UInt mid;
+   UInt nobj;
+   UInt nsend;
+   struct Page *next;
+   size_t size;
+} Page;
+
+/* Page of the collectable object 'o' and the id of its owner. */
+#define page_of(o)  cast(Page *, cast(size_t, o) & ~(size_t)(MA_PAGESIZE - 1))
+#define obj_mid(o)  (page_of(o)->mid)
+
+/* Hand the page 'p' to the maatine of id 'mid'. */
+#define page_give(p, mid)  ((p)->mid = (mid), (p)->nsend = 0)
+
+#endif
@@ -3,6 +3,10 @@
 
 #include "ma_conf"
 #include "ma_mstate"
+#include "ma_timer.h"
+#include "ma_io.h"
+#include "ma_regex.h"
+#include "ma_prof.h"
 
 /* 
  * The Maat VM, running maat program may have multiple instances
@@ -12,6 +16,20 @@
  */
 typedef struct MVM {
 
+   /*
+    * @tw: Timers of the Works waiting on this VM instance for a
+    * deadline ('Work.for', 'Work.til', 'sleep').
+    */
+   TWheel tw;
+
+   /* @io: The I/O reactor of this VM instance, see 'ma_io.h'. */
+   Reactor io;
+
+   /* @rxd: Regex match data reused by all matches, see 'ma_regex.h'. */
+   RXData rxd;
+
+   /* @prof: Sampling profiler state, see 'ma_prof.h'. */
+   Prof prof;
 
    /* To sync traversal on shared objects */
    AO_t pass_smark;
@@ -0,0 +1,149 @@
+/*
+ * @@@Sampling profiler of the VM and the scheduler.
+ * License: AGL, see LICENSE file for details.
+ */
+
+#ifndef ma_prof_h
+#define ma_prof_h
+
+#include "ma_conf.h"
+#include "ma_limits.h"
+#include "ma_val.h"
+
+/*
+ * A profiler thread wakes up every 1/MA_PROFHZ second and samples
+ * every MVM. Walking the stack of a State from another thread
+ * while it runs is racy, so the stack is not walked by the profiler
+ * thread: it only adds a tick to @pending of the MVM and the VM
+ * records its own sample, weighted by the ticks it claims, at the
+ * next safepoint (calls, returns and backward jumps, where it
+ * already checks for preemption), which costs one relaxed load per
+ * safepoint when nobody profiles.
+ *
+ * What an MVM is doing is published in @what on each transition
+ * (entering a GC step, a C function, the scheduler). Ticks owed
+ * are claimed and recorded before the transition so they are never
+ * charged to the next activity. When the MVM is in GC or idle the
+ * profiler thread doesn't add a tick, it records the sample itself
+ * from @what and @maa into a buffer of its own: the stack is not
+ * needed to tell time spent in GC or idle, and only the MVM ever
+ * writes its ring.
+ *
+ * Time spent in a C function is still owed to the MVM: the Maat
+ * stack of the call is intact below the C function, so ticks
+ * received while in it are recorded as PROF_CFN samples with that
+ * stack and the C function as the leaf, either at the next call
+ * the C function makes into the VM or the C API, or when it
+ * returns.
+ *
+ * The stack of a sample is that of the running State of the
+ * maatine followed by its callers through @cw.ca, so the frames of
+ * a generator show under the loop resuming it. The walk stops at
+ * the initial State of the maatine (@state of Maa) whose @cw holds
+ * a Work rather than a caller, included. A suspended coroutine
+ * can't be sampled, it's not running.
+ *
+ * Samples are written by each MVM into its own ring buffer of
+ * MA_PROFBUF entries, a single producer single consumer ring, which
+ * the profiler thread drains, aggregates and dumps as folded
+ * stacks, one line per distinct stack:
+ *
+ *    ma#3;main::serve@srv.mt:12;main::parse@srv.mt:40;[gc] 17
+ *
+ * which is the input format of flame graph tools.
+ */
+#define PROF_VM    0
+#define PROF_GC    1
+#define PROF_CFN   2
+#define PROF_IDLE  3
+
+/*
+ * @@PFrame: A frame of a sample, the line is found at dump time from
+ * @pc and the line info of @fn.
+ */
+typedef struct PFrame {
+   Fn *fn;
+   UInt pc;
+} PFrame;
+
+/*
+ * @@PSample: A sample.
+ *
+ * - @mid: Id of the maatine running on the MVM, 0 if idle.
+ * - @what: One of 'PROF_*'.
+ * - @weight: Number of ticks this sample stands for.
+ * - @depth: Number of frames in @frames, truncated to
+ *   MA_PROFDEPTH innermost frames.
+ */
+typedef struct PSample {
+   UInt mid;
+   UInt weight;
+   UByte what;
+   UByte depth;
+   PFrame frames[MA_PROFDEPTH];
+} PSample;
+
+/*
+ * @@Prof: Profiling state of an MVM.
+ *
+ * - @pending: Ticks owed by the MVM, incremented by the profiler
+ *   thread while the MVM runs Maat code or a C function, claimed
+ *   by the VM with a CAS when it records a sample.
+ * - @what: Activity of the MVM, one of 'PROF_*'.
+ * - @maa: Id of the maatine running on the MVM.
+ * - @buf: Ring buffer of samples, written by the MVM at @head and
+ *   read by the profiler thread at @tail, samples are dropped
+ *   (and counted in @lost) when it's full.
+ */
+typedef struct Prof {
+   AO_t pending;
+   AO_t what;
+   AO_t maa;
+   AO_t head;
+   AO_t tail;
+   AO_t lost;
+   PSample *buf;
+} Prof;
+
+/*
+ * @@Profiler: State of the profiler thread.
+ *
+ * - @hz: Number of ticks per second.
+ * - @own: The @nown samples it recorded itself out of @owncap,
+ *   PROF_GC and PROF_IDLE ones, no MVM ever touches them.
+ */
+typedef struct Profiler {
+   unsigned hz;
+   PSample *own;
+   size_t nown;
+   size_t owncap;
+} Profiler;
+
+/*
+ * At a safepoint of the VM running State 's' of maatine 'm', with
+ * 'w' being PROF_VM, or PROF_CFN from a C function or its return.
+ */
+#define prof_check(p, m, s, w)                                  \
+   (ma_unlikely(AO_load(&(p)->pending)) ? ma_prof_record(p, m, s, w) : (void)0)
+
+/* Publish the activity 'w' of an MVM, flushing ticks owed first. */
+#define prof_what(p, m, s, w)                                   \
+   do {                                                         \
+      prof_check(p, m, s, AO_load(&(p)->what));                 \
+      AO_store(&(p)->what, w);                                  \
+   } while (0)
+
+/*
+ * Claim the ticks of @pending and record the stack of 's' of
+ * maatine 'm' as a sample of activity 'w' weighted by them.
+ */
+MA_IFUNC void ma_prof_record(Prof *p, struct Maa *m, struct State *s, UByte w);
+
+/*
+ * Start the profiler thread sampling at 'hz' times per second, and
+ * stop it writing folded stacks to 'path'.
+ */
+MA_API int ma_prof_start(unsigned hz);
+MA_API int ma_prof_stop(const char *path);
+
+#endif
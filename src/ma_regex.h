@@ -0,0 +1,169 @@
+/*
+ * @@@Regex objects and the cache of compiled patterns.
+ * License: AGL, see LICENSE file for details.
+ */
+
+#ifndef ma_regex_h
+#define ma_regex_h
+
+#ifndef PCRE2_CODE_UNIT_WIDTH
+#define PCRE2_CODE_UNIT_WIDTH  8
+#endif
+#include <pcre2.h>
+
+#include "ma_conf.h"
+#include "ma_limits.h"
+#include "ma_val.h"
+
+/*
+ * @@Regex: A compiled regular expression, it's immutable and thus
+ * freely shared across maatines.
+ *
+ * Literal regexes ('/ERROR (\d+)/') are compiled, JIT compiled
+ * included, by the compiler and land in the constants of their
+ * function, so a match never compiles anything. Regexes built at
+ * runtime from strings go through the cache of @@RXCache.
+ *
+ * - @src: Source of the pattern.
+ * - @hash: Hash of @src and @flags, key of the cache.
+ * - @code: The PCRE2 compiled pattern.
+ * - @flags: Maat regex flags ('i', 'm', 's', 'x', ...).
+ * - @jit: Boolean value, is '1' if @code was JIT compiled so
+ *   matches use 'pcre2_jit_match()'; '0' if JIT is unavailable.
+ * - @ncap: Number of capture groups.
+ *
+ * Prefilter, see 'ma_rx_exec()':
+ * - @lit: The longest literal every match must contain (e.g
+ *   "ERROR " in '/ERROR .../' or "user=" in '/user=\w+/'), NULL
+ *   if the pattern has none of at least 2 bytes. It's always NULL
+ *   for a caseless pattern (flag 'i', or '(?i)' over the literal)
+ *   since the prefilter compares bytes exactly, and it's cut to
+ *   MA_RXLITMAX bytes, enough for the scan to be selective.
+ * - @litkind: One of 'LIT_*'.
+ * - @rare: Offset in @lit of its rarest byte according to a
+ *   static byte frequency table, the SIMD scan looks for it and
+ *   for the first byte of @lit at once. @lit is at most
+ *   MA_RXLITMAX bytes so it fits.
+ * - @maxback: How many bytes before an occurrence of @lit a match
+ *   may start, MAX_SIZE if unbounded.
+ */
+#define LIT_NONE    0
+#define LIT_PREFIX  1
+#define LIT_INNER   2
+
+typedef struct Regex {
+   Header;
+   Str *src;
+   UInt hash;
+   pcre2_code *code;
+   UInt flags;
+   UByte jit;
+   UInt ncap;
+   Str *lit;
+   UByte litkind;
+   UByte rare;
+   size_t maxback;
+} Regex;
+
+/*
+ * @@RXCache: Bounded cache of regexes built at runtime, in GMaa.
+ * It's set associative: a key selects a set of MA_RXWAYS entries
+ * and within a set, the entry whose @ref bit is clear is evicted
+ * (a CLOCK approximation of LRU). Lookups are lock-free loads of
+ * the entries of one set, inserts replace an entry with a CAS and
+ * a loser just uses its own Regex uncached.
+ *
+ * A cached Regex is a shared object and the cache is a root: every
+ * maatine marks the entries of all the sets when it marks its
+ * roots, so no LSO sweep frees a cached Regex. An evicted Regex
+ * may still be in use by a maatine that loaded it right before the
+ * CAS, the evicting maatine thus keeps it in its @evicted list, see
+ * @@Evicted, and only then does it go the LSO way once unreachable.
+ *
+ * - @sets: MA_RXSETS sets of MA_RXWAYS entries.
+ * - @ref: Reference bits of the entries, set on hit.
+ * - @hand: Per set clock hand, moved with a CAS by inserts.
+ */
+typedef struct RXCache {
+   AO_t sets[MA_RXSETS][MA_RXWAYS];
+   AO_t ref[MA_RXSETS][MA_RXWAYS];
+   AO_t hand[MA_RXSETS];
+} RXCache;
+
+/*
+ * @@Evicted: A Regex evicted from the cache, Snips embed the same
+ * fields. It stays a root of the evicting maatine until @gc_epoch
+ * of GMaa is past @epoch + 1: every maatine then passed an atomic
+ * phase that started after the eviction, so a maatine still using
+ * the object has it marked from its own roots.
+ *
+ * - @o: The evicted object.
+ * - @epoch: 'ep_epoch()' of @gc_epoch at eviction.
+ * - @next: Next evicted object of the maatine.
+ */
+typedef struct Evicted {
+   Object *o;
+   UMem epoch;
+   struct Evicted *next;
+} Evicted;
+
+#define rx_set(h)  ((h) & (MA_RXSETS - 1))
+
+/*
+ * @@RXData: Match data of an MVM, allocated once per OS thread and
+ * reused by every match of the maatines it runs.
+ *
+ * - @md: PCRE2 match data, grown when a pattern has more capture
+ *   groups than it can hold.
+ * - @ncap: Number of capture groups @md can hold.
+ * - @jstk: JIT stack used by 'pcre2_jit_match()'.
+ * - @mctx: Match context holding @jstk.
+ */
+typedef struct RXData {
+   pcre2_match_data *md;
+   UInt ncap;
+   pcre2_jit_stack *jstk;
+   pcre2_match_context *mctx;
+} RXData;
+
+/*
+ * Compile 'src' with 'flags' and JIT compile the result, used by
+ * the compiler for literal regexes.
+ */
+MA_IFUNC Regex *ma_rx_compile(struct Maa *m, Str *src, UInt flags);
+
+/* Return the cached Regex for 'src' and 'flags', compiling it on a miss. */
+MA_IFUNC Regex *ma_rx_get(struct Maa *m, RXCache *c, Str *src, UInt flags);
+
+/*
+ * Match 'rx' against 's' from 'offset' with the match data of the
+ * MVM running 'm', return the number of captures or a negative
+ * PCRE2 error code.
+ *
+ * When @lit is set, PCRE2 only runs on candidates: positions of
+ * @lit found by 'ma_memmem()'. A LIT_PREFIX literal gives the
+ * start of the match, PCRE2 is called anchored there. A LIT_INNER
+ * literal found at 'p' means a match may start in
+ * '[p - maxback, p]', PCRE2 is called from there and the scan
+ * resumes after the end of the match or after 'p'. No occurrence
+ * means no match without running PCRE2 at all.
+ */
+MA_IFUNC int ma_rx_exec(struct Maa *m, Regex *rx, Str *s, size_t offset);
+
+/*
+ * Extract the required literal of the compiled 'rx' and fill its
+ * prefilter fields, called once after compilation.
+ */
+MA_IFUNC void ma_rx_lit(Regex *rx);
+
+/*
+ * Find 'needle' of 'nlen' bytes in 'hay' of 'hlen' bytes. The scan
+ * compares 16 (SSE2/NEON) or 32 (AVX2) positions at once against
+ * both the first byte of 'needle' and its byte at 'rare', only
+ * positions matching both are verified with memcmp. Without SIMD
+ * it falls back to memchr on the rare byte.
+ */
+MA_IFUNC const Byte *ma_memmem(const Byte *hay, size_t hlen, const Byte *needle,
+                               size_t nlen, size_t rare);
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * @@@Cache of the Maat snippets of the C API, 'PVal("...")' and
+ * 'Fn(":...")'.
+ * License: AGL, see LICENSE file for details.
+ */
+
+#ifndef ma_snip_h
+#define ma_snip_h
+
+#include "ma_conf.h"
+#include "ma_limits.h"
+#include "ma_val.h"
+
+/*
+ * Snippets are parsed and compiled once. The result is cached in
+ * GMaa keyed by the source text, so later calls with the same text
+ * from any thread skip the parser and the compiler:
+ *
+ * - 'Fn(src)' caches the compiled Fn, a call just makes a closure
+ *   of it. A snippet closing over nothing and without static
+ *   lexicals needs no allocation at all as its closure is cached
+ *   too, see 'snip_sharesclo()'. A closure with a @state can't be
+ *   shared: every call would see the static lexicals of the others.
+ * - 'PVal(src)' caches the value the snippet evaluated to, frozen
+ *   into a template when it's only made of constants (numbers,
+ *   strings, nested Arrays and Maps of them). A call then clones
+ *   the template, which is a walk copying buffers without running
+ *   any code. Snippets with anything else (calls, variables) are
+ *   cached as an Fn and run on each call.
+ *
+ * The cache has the same set associative layout as the regex cache
+ * (@@RXCache): lock-free lookups, inserts with a CAS and CLOCK
+ * eviction. Cached Fns and templates are shared immutable objects.
+ *
+ * A Snip itself isn't collectable, it's allocated and freed by
+ * the cache, but what it holds is: the cache is a root of every
+ * maatine as the regex cache is, marking a cached Snip marks its
+ * @src, its @u.fn or every object of its @u.tpl template, and its
+ * @clo, all of them shared. An evicted Snip may still be in use by
+ * a thread that loaded it right before the CAS, so the evicting
+ * maatine keeps it in its @snip_evicted list, still a root, until
+ * @gc_epoch of GMaa is past @evepoch + 1 as for @@Evicted. It's
+ * then freed and its objects go the LSO way once unreachable.
+ */
+#define SNIP_FN   0
+#define SNIP_TPL  1
+
+/*
+ * @@Snip: A cached snippet.
+ *
+ * - @src: The source text, an internalized or hashed string.
+ * - @kind: SNIP_FN or SNIP_TPL.
+ * - @u: The compiled function or the value template.
+ * - @clo: For SNIP_FN whose Fn passes 'snip_sharesclo()', its
+ *   shared closure, NULL otherwise.
+ * - @evepoch, @evnext: Epoch of eviction and next evicted Snip of
+ *   the evicting maatine, see @snip_evicted.
+ */
+typedef struct Snip {
+   Str *src;
+   UByte kind;
+   union {
+      Fn *fn;
+      Value tpl;
+   } u;
+   Closure *clo;
+   UMem evepoch;
+   struct Snip *evnext;
+} Snip;
+
+/* Whether the closures of the snippet Fn 'f' can all be one. */
+#define snip_sharesclo(f)  ((f)->nuv == 0 && !((f)->flags & FN_STATE))
+
+typedef struct SnipCache {
+   AO_t sets[MA_SNIPSETS][MA_SNIPWAYS];
+   AO_t ref[MA_SNIPSETS][MA_SNIPWAYS];
+   AO_t hand[MA_SNIPSETS];
+} SnipCache;
+
+/*
+ * Return the cached snippet of 'src' of 'len' bytes, compiling it
+ * on the calling thread on a miss.
+ */
+MA_IFUNC Snip *ma_snip_get(struct Maa *m, SnipCache *c, const char *src, size_t len);
+
+/* Clone the template 'tpl' into 'v', owned by 'm'. */
+MA_IFUNC void ma_snip_clone(struct Maa *m, const Value *tpl, Value *v);
+
+#endif
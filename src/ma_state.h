@@ -10,20 +10,66 @@
 #include "ma_val.h"
 
 /*
- * @@SV: SV is a stack element of the @svs stack for special variables.
- *
- * - @id: Id of the scope these special variables belongs to.
- * - @sv: Special variables of this scope, possible keys:
+ * @@SVR: Special variables record, it holds the result of the last
+ * successful regex match of a scope:
  *
  *  #<digit>(#1, #2, #3, etc), #., #`, #&, #', #C, #N, ... (to be added)
  *
- * It's mostly internal C code that reads/writes these special variables.
- * e.g the ".match" regex method.
+ * Each scope of a function that performs a match gets at compile
+ * time a unique index into the records of its frame, and @svrup
+ * of the function gives the record of the nearest enclosing scope
+ * that also performs a match. Whether a scope did match is only
+ * known at runtime, so a read of '#1' compiles to the index of the
+ * record of the innermost matching scope and 'svr_find()' walks up
+ * this static chain to the first record with a subject. Nothing
+ * happens at runtime when a scope is popped.
+ *
+ * Records are filled by internal C code (e.g the ".match" regex
+ * method) which only stores the subject and the capture offsets,
+ * substrings are built lazily when a special variable is read.
+ *
+ * - @subj: Subject of the last match, NULL if the scope has not
+ *   matched yet.
+ * - @ncap: Number of captures of the last match, '#&' included.
+ * - @ovec: Start and end offsets of the first MA_SVNCAP captures.
+ * - @xovec: Offsets of the captures past MA_SVNCAP, if any.
  */
-typedef struct SV {
-   Map *sv;
-   UByte sc_id;
-} SV;
+typedef struct SVR {
+   Str *subj;
+   UInt ncap;
+   size_t ovec[2 * MA_SVNCAP];
+   size_t *xovec;
+} SVR;
+
+/* Start and end offsets of capture 'n' ('#&' is 0) in record 'r'. */
+#define svr_so(r, n)  \
+   ((n) < MA_SVNCAP ? (r)->ovec[2 * (n)] : (r)->xovec[2 * ((n) - MA_SVNCAP)])
+#define svr_eo(r, n)  \
+   ((n) < MA_SVNCAP ? (r)->ovec[2 * (n) + 1] : (r)->xovec[2 * ((n) - MA_SVNCAP) + 1])
+
+/* Reset record 'r' when entering its scope. */
+#define svr_reset(r)  ((r)->subj = NULL, (r)->ncap = 0)
+
+/* Record 'i' of the callframe 'cf' of state 's'. */
+#define cf_svr(s, cf, i)  (&(s)->svrs[(cf)->svr + (i)])
+
+/*
+ * Set 'r' to the record a special variable read from record 'i' of
+ * the callframe 'cf' of function 'f' resolves to, NULL if no
+ * enclosing scope matched.
+ */
+#define svr_find(s, cf, f, i, r)                         \
+   do {                                                  \
+      UByte j_ = (i);                                    \
+      (r) = cf_svr(s, cf, j_);                           \
+      while ((r)->subj == NULL) {                        \
+         if ((j_ = (f)->svrup[j_]) == SVR_NOUP) {        \
+            (r) = NULL;                                  \
+            break;                                       \
+         }                                               \
+         (r) = cf_svr(s, cf, j_);                        \
+      }                                                  \
+   } while (0)
 
 /* @@CallFrame: Just a callframe. */
 typedef struct CallFrame {
@@ -55,24 +101,12 @@ typedef struct CallFrame {
    Closure *clo;
 
    /*
-    * - @svs: Stack of @@SV elements.
-    * - @ssize: Stack size.
-    * - @stop: Index of the top element to-be popped when we exit
-    *   the scope the SV element corresponds to. The front always
-    *   gets the special variable we want to runtime resolve, so
-    *   it's fast.
+    * @svr: Index in the @svrs buffer of the State of the first of
+    * the @nsvr special variables records of the function of this
+    * callframe, an index rather than a pointer since @svrs moves
+    * when it grows, see @@SVR.
     */
-   SV *svs;
-   UByte stop;
-   UByte ssize;
-
-   /*
-    * @sc_id: The id of the current scope in this callframe. Sadly,
-    * to empty the SV stack we will have to check at each scope pop
-    * operation if @sc_id is the same as that of the top element of
-    * the SV stack.
-    */
-   UByte sc_id;
+   size_t svr;
 
    /*
     * - @f_offset: Class' role or inherited methods need specific
@@ -89,13 +123,31 @@ typedef struct CallFrame {
  * @@State: A state can either be a blocking vm-level thread i.e
  * a coroutine or a generator function or simply the initial state
  * of a Maatine.
+ *
+ * States start tiny (MA_MINSTACK values and MA_MINCSTK frames) so
+ * that a million of suspended coroutines or generators don't cost
+ * a million of full stacks. A stack grows by reallocation, thus
+ * every pointer into it (@top, @stack_hwm, @base of each frame in
+ * @cstk and @p of each open upvalue in @ouv) is saved as an offset
+ * before the reallocation and restored after, see 'ma_stk_realloc()'.
+ * Shared upvalues are boxed at creation and never in @ouv, only
+ * the owning maatine reads the @p it rewrites.
+ * The collector halves the stack of a state whose @stack_hwm stayed
+ * under a quarter of its size in the last cycle, never going below
+ * MA_MINSTACK.
  */
 typedef struct State {
    Header;
 
-   /* @state: State of this state/coroutine. */
+   /* @state: State of this state/coroutine, one of 'ST_*'. */
    UByte state;
 
+   /*
+    * @nxfer: Number of values crossing the boundary on the last
+    * resume/yield, they sit at the top of the receiving stack.
+    */
+   UByte nxfer;
+
    /*
     * - @cstk: A stack of callframes.
     * - @cs_cap: Capacity of the @callstack.
@@ -106,11 +158,29 @@ typedef struct State {
    size_t cs_size;
 
    /*
-    * @stack:
-    * @top:
+    * @stack: The value stack, it starts with MA_MINSTACK slots and
+    * grows on demand, see 'stk_check()'.
+    * @top: First free slot of @stack.
+    * @stack_last: Last usable slot of @stack, MA_EXTRASTACK slots
+    * are kept past it for metamethod and C calls that don't check.
+    * @stack_hwm: Highest @top seen since the last GC cycle, used
+    * by the collector to shrink an idle @stack.
     */
    Value *stack;
    Value *top;
+   Value *stack_last;
+   Value *stack_hwm;
+
+   /*
+    * - @svrs: Buffer of special variables records, a call takes
+    *   the @nsvr records its function needs at @svr_top and gives
+    *   them back when it returns.
+    * - @svr_cap: Capacity of @svrs.
+    * - @svr_top: Number of records in use.
+    */
+   SVR *svrs;
+   size_t svr_cap;
+   size_t svr_top;
 
    /* @ouv: Linked-list of open upvals of this state. */
    Upval *ouv;
@@ -137,4 +207,105 @@ typedef struct State {
    } cw;
 } State;
 
+/* Possible values of @state. */
+#define ST_SUSPENDED  0
+#define ST_RUNNING    1
+#define ST_NORMAL     2
+#define ST_DEAD       3
+
+/*
+ * Resume coroutine/generator 'co' from the running state of the
+ * maatine 'm', 'n' values at the top of the running stack are
+ * moved to that of 'co'. This is just a pointer swap of @running,
+ * nothing is allocated.
+ */
+#define co_resume(m, co, n)                  \
+   do {                                      \
+      State *ca_ = (m)->running;             \
+      ma_assert((co)->state == ST_SUSPENDED);\
+      co_xmove(ca_, co, n);                  \
+      (co)->cw.ca = ca_;                     \
+      ca_->state = ST_NORMAL;                \
+      (co)->state = ST_RUNNING;              \
+      (m)->running = (co);                   \
+   } while (0)
+
+/* Yield 'n' values from the running coroutine of 'm' to its caller. */
+#define co_yield(m, n)                       \
+   do {                                      \
+      State *co_ = (m)->running;             \
+      State *ca_ = co_->cw.ca;               \
+      co_xmove(co_, ca_, n);                 \
+      co_->state = ST_SUSPENDED;             \
+      ca_->state = ST_RUNNING;               \
+      (m)->running = ca_;                    \
+   } while (0)
+
+/*
+ * Yield the single value 'v' of a generator driven by a 'for'
+ * loop, it goes through the transfer slot @xfer of the maatine
+ * so that the loop reads it without boxing an iterator result
+ * and without touching the stack of the caller.
+ */
+#define co_yield1(m, v)                      \
+   do {                                      \
+      State *co_ = (m)->running;             \
+      State *ca_ = co_->cw.ca;               \
+      (m)->xfer = (v);                       \
+      ca_->nxfer = 0;                        \
+      co_->state = ST_SUSPENDED;             \
+      ca_->state = ST_RUNNING;               \
+      (m)->running = ca_;                    \
+   } while (0)
+
+/* Move 'n' values from the top of 'from' to the top of 'to'. */
+#define co_xmove(from, to, n)                            \
+   do {                                                  \
+      size_t i_;                                         \
+      stk_check(to, n);                                  \
+      for (i_ = 0; i_ < (n); i_++)                       \
+         (to)->top[i_] = ((from)->top - (n))[i_];        \
+      (from)->top -= (n);                                \
+      (to)->top += (n);                                  \
+      (to)->nxfer = (n);                                 \
+   } while (0)
+
+/* Size in slots of @stack, without the extra slots. */
+#define stk_size(s)  cast(size_t, (s)->stack_last - (s)->stack)
+
+/* Save and restore a pointer into @stack across a reallocation. */
+#define stk_save(s, p)     cast(size_t, (p) - (s)->stack)
+#define stk_restore(s, o)  ((s)->stack + (o))
+
+/*
+ * Make sure 'n' more slots are available, growing @stack if not.
+ * The difference is negative when @top is in the extra slots, so
+ * 'n' is compared as a ptrdiff_t rather than converting it.
+ */
+#define stk_check(s, n)                                         \
+   (ma_likely((s)->stack_last - (s)->top >= cast(ptrdiff_t, n)) \
+       ? (void)0                                                \
+       : ma_stk_grow(s, n))
+
+/* Track the high-water mark after a call pushed its frame. */
+#define stk_hwm(s)  \
+   ((s)->top > (s)->stack_hwm ? (void)((s)->stack_hwm = (s)->top) : (void)0)
+
+/*
+ * Grow @stack of 's' to hold at least 'n' more slots, doubling
+ * its size and fixing up pointers into it. Raise a stack overflow
+ * if it would go past MA_MAXSTACK.
+ */
+MA_IFUNC void ma_stk_grow(State *s, size_t n);
+
+/* Reallocate @stack of 's' to 'size' slots with pointer fixups. */
+MA_IFUNC void ma_stk_realloc(State *s, size_t size);
+
+/*
+ * Called by the collector when traversing 's', shrink @stack and
+ * @cstk if they were mostly idle since the last cycle and reset
+ * @stack_hwm.
+ */
+MA_IFUNC void ma_stk_shrink(State *s);
+
 #endif
@@ -7,6 +7,7 @@
 #define ma_str_h
 
 #include "ma_val.h"
+#include "ma_hash.h"
 
 #define REV_BIT  (0b1 << 7)
 
@@ -30,11 +31,19 @@
 #define next_str(s)  (s->u.snext)
 
 #define is_lng(s)  (check_rtype(s, O_VLNGSTR) || check_rtype(s, O_VLNG2STR))
+#define is_slc(s)  (check_rtype(s, O_VLNGSTR) && (s->sl & STR_SLCBIT))
 
-/* Hash of short strings */
+/* Bytes of the string 's', be it a slice or not. */
+#define sdata(s)  (is_slc(s) ? s2slc(s)->parent->str + s2slc(s)->off : (s)->str)
+
+/*
+ * Hash of strings, short strings get it when internalized and long
+ * ones on first use, see 'ma_hash.h'.
+ */
 #define hashval(s)    (s->hash)
-#define is_hashed(s)  (is_lng(s) && s->sl == 1)
-#define markhash(s)   (ma_assert(is_lng(s)), s->sl = 1)
+#define strhash(s, seed)  hs_fold(ma_hash_bytes(sdata(s), len(s), seed))
+#define is_hashed(s)  (is_lng(s) && (s->sl & STR_HASHBIT))
+#define markhash(s)   (ma_assert(is_lng(s)), s->sl |= STR_HASHBIT)
 
 /* Says 's' should be an U8Str, true? */
 #define is_u8s(s)  ma_assert(check_type(s, O_U8STR))
@@ -42,4 +51,13 @@
 /* Get visual length of 's'. */
 #define vlen(s)  (is_u8s(s) ? (len(s) - a2u8(s)->ngraph) : len(s))
 
+/*
+ * Translate 'len' bytes of 'src' into 'dst' through the 256 bytes
+ * table 'map', the kernel behind 'Str.tr'. Ranges of the table
+ * that are identities are detected when building it and with SIMD
+ * the common case of a few translated bytes is done 16/32 bytes at
+ * a time with byte shuffles over the 16 entries nibble tables.
+ */
+MA_IFUNC void ma_tr(Byte *dst, const Byte *src, size_t len, const UByte map[256]);
+
 #endif
@@ -0,0 +1,135 @@
+/*
+ * @@@Hierarchical timing wheel backing 'Work.for', 'Work.til' and
+ * 'sleep'.
+ * License: AGL, see LICENSE file for details.
+ */
+
+#ifndef ma_timer_h
+#define ma_timer_h
+
+#include <stdint.h>
+#include "ma_conf.h"
+#include "ma_limits.h"
+
+/*
+ * A wheel has MA_TWLEVELS levels of MA_TWSLOTS slots each. A slot
+ * of level 0 spans MA_TWTICK ns and a slot of level 'l' spans a
+ * whole turn of level 'l - 1'. A Work waiting for a deadline is
+ * put in the slot of the lowest level whose span covers the delay
+ * and cascades down a level each time its slot is reached, so
+ * insertion and cancellation are O(1) and firing is amortized
+ * O(1) per timer.
+ *
+ * Timers of a slot are coalesced: they all fire on the same wakeup
+ * of the scheduler thread, the skew of a timer is therefore at most
+ * MA_TWTICK.
+ */
+#define TW_BITS   6
+#define TW_MASK   (MA_TWSLOTS - 1)
+
+/* Slot of level 'l' for the tick 't'. */
+#define tw_slot(t, l)  (((t) >> ((l) * TW_BITS)) & TW_MASK)
+
+/*
+ * @@Timer: Timer node, embedded in the Work it belongs to.
+ *
+ * - @next, @prev: Links in the slot list, a circular doubly linked
+ *   list so that cancelling is an unlink.
+ * - @tw: Wheel the timer was last armed in, set by 'ma_tw_add()'
+ *   under the lock of the wheel. Maatines migrate between MVMs, so
+ *   a cancel may come from a thread of another MVM and finds the
+ *   wheel to lock here.
+ * - @expires: Tick at which the timer fires.
+ */
+typedef struct Timer {
+   struct Timer *next;
+   struct Timer *prev;
+   struct TWheel *tw;
+   uint64_t expires;
+} Timer;
+
+#define tm_linked(tm)  ((tm)->next != NULL)
+
+/* Unlink 'tm' from its slot, O(1). */
+#define tm_unlink(tm)                        \
+   do {                                      \
+      (tm)->prev->next = (tm)->next;         \
+      (tm)->next->prev = (tm)->prev;         \
+      (tm)->next = (tm)->prev = NULL;        \
+   } while (0)
+
+/* Link 'tm' at the end of the slot list headed by 'h', O(1). */
+#define tm_link(h, tm)                       \
+   do {                                      \
+      (tm)->prev = (h)->prev;                \
+      (tm)->next = (h);                      \
+      (h)->prev->next = (tm);                \
+      (h)->prev = (tm);                      \
+   } while (0)
+
+/*
+ * @@TWheel: The timing wheel of an MVM.
+ *
+ * - @lock: Spinlock taken by every operation on the wheel. Timers
+ *   are armed and cancelled by maatines running on any thread of
+ *   the MVM while its scheduler thread advances the wheel, all of
+ *   them O(1) but for the cascade so the lock is never held long.
+ * - @now: Current tick, advanced by the scheduler thread.
+ * - @start: Monotonic time in ns of tick 0.
+ * - @ntimers: Number of pending timers.
+ * - @slots: Heads of the slot lists of each level.
+ *
+ * Times and ticks are on 64 bits whatever the width of UMem, a
+ * monotonic time in ns wraps 32 bits in about 4 seconds.
+ *
+ * No collector walks the wheel. Arming a Work marks it shared, the
+ * scheduler thread completes it, and the Work stays alive until
+ * its timer fires or is cancelled because the collector of its
+ * owner, the maatine of 'obj_mid()' of the Work, treats each Work
+ * of its LSO whose timer is linked as a root, checking
+ * 'tm_linked()' under the lock of @tw of the timer. Where the
+ * owner runs and which wheel holds the timer don't matter.
+ */
+typedef struct TWheel {
+   AO_TS_t lock;
+   uint64_t now;
+   uint64_t start;
+   size_t ntimers;
+   Timer slots[MA_TWLEVELS][MA_TWSLOTS];
+} TWheel;
+
+#define tw_lock(tw)    while (AO_test_and_set_acquire(&(tw)->lock) == AO_TS_SET)
+#define tw_unlock(tw)  AO_CLEAR(&(tw)->lock)
+
+/* Convert a monotonic time in ns into a tick of wheel 'tw'. */
+#define tw_tick(tw, ns)  (((ns) - (tw)->start + MA_TWTICK - 1) / MA_TWTICK)
+
+/*
+ * Arm the timer 'tm' of a Work to fire at tick 'exp' of 'tw', the
+ * wheel of the MVM the arming maatine runs on, and record 'tw' in
+ * @tw of 'tm'.
+ */
+MA_IFUNC void ma_tw_add(TWheel *tw, Timer *tm, uint64_t exp);
+
+/*
+ * Cancel 'tm' if it's still pending, from any thread of any MVM. It
+ * takes the lock of the wheel in @tw of 'tm' and checks
+ * 'tm_linked()' under it, so a cancel racing with the timer firing
+ * is a no-op.
+ */
+MA_IFUNC void ma_tw_del(Timer *tm);
+
+/*
+ * Advance 'tw' up to the tick of monotonic time 'ns', cascading
+ * timers of higher levels and moving the Work of every expired
+ * timer to Done so that the scheduler runs its 'then' chain.
+ */
+MA_IFUNC void ma_tw_advance(TWheel *tw, uint64_t ns);
+
+/*
+ * Monotonic time in ns at which the next timer may fire, the
+ * scheduler thread sleeps until then when it has nothing to run.
+ */
+MA_IFUNC uint64_t ma_tw_next(TWheel *tw);
+
+#endif
@@ -139,8 +139,7 @@ typedef struct Value {
 /* Header common to all collectable Maat objects. */
 #define Header  struct Class *class;  \
                 struct Object *next;   \
-                UInt mid;               \
-                UByte type;              \
+                UByte type;             \
                 UByte mark
 
 /*
@@ -150,7 +149,10 @@ typedef struct Value {
  * - @mark: To mark the object during collection.
  * - @class: The object's class.
  * - @next: Next obj, to keep track of all objects.
- * - @mid: The id of the maatine that created the object.
+ *
+ * The id of the maatine owning an object isn't in its header but
+ * in that of the page it was allocated from, see 'obj_mid()' in
+ * 'ma_mem.h'.
  */
 #define SHARE_BIT     (0b1 << 7)
 #define is_shared(o)  ((o)->mark & SHARE_BIT)
@@ -167,7 +169,7 @@ typedef struct Object {
 /* O_VINS O_VCINS */
 #define O_INS    6
 
-/* O_VSHTSTR, O_VLNGSTR */
+/* O_VLNGSTR, O_VSHTSTR, O_VUSHTSTR, O_VLNG2STR */
 #define O_STR    7
 
 /* O_VRANGE, O_VSRANGE? */
@@ -179,6 +181,9 @@ typedef struct Object {
 /* O_VMAP, O_VCMAP */
 #define O_MAP    10
 
+/* O_VREGEX */
+#define O_REGEX  11
+
 /* O_VCHAN, O_VSCHEDQ */
 #define O_RBQ    12
 
@@ -200,25 +205,39 @@ typedef struct Object {
 /* O_VNS */
 #define O_NS     18
 
+/* Number of base types, collectable or not. */
+#define O_NTYPES  19
+
 /* @@@Repr of all type of string objects. */
 #define O_VLNGSTR   vary(O_STR, 0)
 #define O_VSHTSTR   vary(O_STR, 1)
+#define O_VUSHTSTR  vary(O_STR, 2)
+#define O_VLNG2STR  vary(O_STR, 3)
+
+/*
+ * Bits of @sl of a long string, a field it has no other use for.
+ * The 2 variant bits of O_STR are all taken, so a slice (@@SlStr)
+ * is an O_VLNGSTR with STR_SLCBIT set rather than a variant.
+ */
+#define STR_HASHBIT  (0b1 << 0)
+#define STR_SLCBIT   (0b1 << 1)
 
 #define str2v(s, v)  gco2val(s, v)
 #define v2str(v)     (ma_assert(is_str(v)), gco2str((v).gc_obj))
 
 #define is_str(v)  check_type(v, O_STR)
 
-#define is_shtstr(v)  (check_rtype(v, ctb(O_VSHTSTR))
-#define is_lngstr(v)  (check_rtype(v, ctb(O_VLNGSTR))
+#define is_shtstr(v)  check_rtype(v, ctb(O_VSHTSTR))
+#define is_lngstr(v)  check_rtype(v, ctb(O_VLNGSTR))
+#define is_slcstr(v)  (is_lngstr(v) && (as_str(v)->sl & STR_SLCBIT))
 
 #define as_str(v)  (ma_assert(is_str(v)), cast(Str *, as_gcobj(v)))
 
 /*
  * @@Str: Repr of an ASCII Maat string.
  *
- * - @sl: Length of the short string, this field is useless for
- *   long strings but plays nicely with 4/8-bytes alignment.
+ * - @sl: Length of the short string, for long strings it only
+ *   holds STR_HASHBIT and STR_SLCBIT.
  * - @check: For short strings, check if @str is a reserved word.
  *   For long strings, check if @str already has its hash.
  * - @hash: Hash value of @str, trailing pads plays nicely with
@@ -240,6 +259,39 @@ typedef struct Str {
    Byte str[flex];            
 } Str;
 
+/*
+ * @@SlStr: A slice of a long string, it's what 'split', 'first',
+ * 'last', 'div' and regex captures return instead of a copy when
+ * the result is too long to be a short string. A slice is a long
+ * string for every purpose, it has the same fields as @@Str up to
+ * @hash, its hash is that of its bytes and so it's equal to and
+ * hashes like a copy would. Results short enough to be short
+ * strings are always copied and internalized as usual. Its type
+ * is O_VLNGSTR, STR_SLCBIT in @sl tells it apart.
+ *
+ * - @parent: The long string holding the bytes, never a slice
+ *   itself, slicing a slice slices its parent.
+ * - @off: Offset of the first byte in @parent.
+ * - @gcl: Link in the @slices list of the maatine during a cycle.
+ *
+ * The collector may compact a slice that isn't shared, i.e give it
+ * a parent of its own holding just its bytes, when @parent is only
+ * kept alive by small slices, see "String Slices" in 'docs/gc.md'.
+ */
+typedef struct SlStr {
+   Header;
+   UByte sl;
+   UByte check;
+   union {
+      struct Str *snext;
+      size_t len;
+   } u;
+   UInt hash;
+   Str *parent;
+   size_t off;
+   Object *gcl;
+} SlStr;
+
 /*
  * @@Range object with each bound inclusive.
  *
@@ -332,6 +384,14 @@ typedef union Node {
  * - @node: Hash part of the Map.
  * - @last: The last free node in @node.
  * - @lg2size: log2 of the size of @node.
+ *
+ * - @cards: Card table covering @array then @node, NULL unless
+ *   the Map has at least MA_CARDMIN slots, see 'card_mark()'.
+ *
+ * - @weak: Weakness of the Map, a combination of 'WK_*' bits, 0
+ *   for a regular Map.
+ * - @wdirty: Age of the newest entry of a weak Map, one of
+ *   'WK_CLEAN', 'WK_DIRTY1' or 'WK_DIRTY2', see 'wk_touch()'.
  */
 #define MapPointerfields
 
@@ -343,11 +403,45 @@ typedef struct Map {
    Node *node;
    Node *last;
    Object *gcl;
+   UByte *cards;
    UInt asize;
    UByte rasize;
    UByte lg2size;
+   UByte weak;
+   UByte wdirty;
 } Map;
 
+/*
+ * Weak Maps, see "Weak Maps" and "Ephemeron Maps" in 'docs/gc.md'.
+ *
+ * - WK_KEY: Keys are weak, an entry goes away with its key.
+ * - WK_VAL: Values are weak, an entry goes away with its value.
+ * - WK_EPHE: Weak keys with ephemeron semantics, a value is only
+ *   kept alive through an entry whose key is alive.
+ */
+#define WK_KEY   (0b1 << 0)
+#define WK_VAL   (0b1 << 1)
+#define WK_EPHE  (WK_KEY | (0b1 << 2))
+
+#define is_weak(m)     ((m)->weak != 0)
+#define is_wkkey(m)    ((m)->weak & WK_KEY)
+#define is_wkval(m)    ((m)->weak & WK_VAL)
+#define is_ephe(m)     (((m)->weak & WK_EPHE) == WK_EPHE)
+
+/*
+ * A new entry was set into the weak Map 'm'. Its weak parts may be
+ * young and a young object takes two minor collections to become
+ * old, so 'm' is revisited by both: a minor collection visiting a
+ * 'WK_DIRTY1' Map makes it 'WK_DIRTY2' and a 'WK_DIRTY2' one
+ * 'WK_CLEAN', just like the 'touched1'/'touched2' marks.
+ */
+#define WK_CLEAN   0
+#define WK_DIRTY2  1
+#define WK_DIRTY1  2
+
+#define wk_touch(m)  ((m)->wdirty = WK_DIRTY1)
+#define wk_age(m)    ((m)->wdirty > WK_CLEAN ? (void)((m)->wdirty--) : (void)0)
+
 /*
  * @@CMap: A thread-safe version of the Map object.
  *
@@ -384,7 +478,8 @@ typedef struct CMap {
 
 #define Arrayfields  Object *gcl; \
                      Value *array;       \
-                     size_t cap;          \
+                     UByte *cards;        \
+                     size_t cap;           \
                      size_t size
 /*
  * @@Array: Repr of an Array object.
@@ -392,12 +487,34 @@ typedef struct CMap {
  * - @size: The size of @array.
  * - @cap: The capacity of @array.
  * - @array: The array itself.
+ * - @cards: Card table of @array, NULL unless @cap is at least
+ *   MA_CARDMIN, see 'card_mark()'.
  */
 typedef struct Array {
    Header;
    Arrayfields;
 } Array;
 
+/*
+ * Card marking of large Arrays and Maps. Their buffers are split
+ * into cards of MA_CARDSIZE slots, when an old object of this kind
+ * gets a pointer to a nursery object, the write barrier dirties
+ * the card of the written slot instead of marking the whole object
+ * touched, then a minor collection only scans dirty cards. A card
+ * holds the same 'touched1'/'touched2' marks as a touched object,
+ * see "Card Marking" in 'docs/gc.md'. 'card_mark()' only raises a
+ * card, thus CARD_TOUCHED1 must compare above CARD_TOUCHED2 so that
+ * dirtying a 'touched2' card makes it 'touched1' again.
+ */
+#define CARD_CLEAN     0
+#define CARD_TOUCHED2  1
+#define CARD_TOUCHED1  2
+
+#define card_of(i)      ((i) / MA_CARDSIZE)
+#define ncards(n)       (((n) + MA_CARDSIZE - 1) / MA_CARDSIZE)
+#define card_mark(o, i, t)  \
+   ((o)->cards[card_of(i)] < (t) ? (void)((o)->cards[card_of(i)] = (t)) : (void)0)
+
 /*
  * @@CArray: A thread-safe lock-free version of @@Array.
  *
@@ -409,6 +526,24 @@ typedef struct CArray {
    /* TODO: librs fields */
 } CArray;
 
+/*
+ * @@UVDesc: Compile time description of an upvalue of a function.
+ *
+ * - @idx: Index of the captured lexical, either a register of
+ *   the enclosing frame or a slot in the upvalue list of the
+ *   enclosing closure.
+ * - @instack: Boolean value, is '1' if @idx is a register of the
+ *   enclosing frame; '0' otherwise.
+ * - @shr: Boolean value set by the escape analysis of the
+ *   compiler, is '1' if the captured lexical may be reached from
+ *   another maatine; '0' otherwise. See 'docs/concurrency.md'.
+ */
+typedef struct UVDesc {
+   UByte idx;
+   UByte instack;
+   UByte shr;
+} UVDesc;
+
 /*
  * @@Fn: Repr of a Maat function object. A functions will not
  * be represented as a first class value as they are referenced
@@ -418,16 +553,52 @@ typedef struct CArray {
  * - @code: Its bytecode.
  * - @cons: The function's constant values.
  * - @ns: Access index to namespace of the function in @NSBuf.
+ * - @uvd: Descriptions of the @nuv upvalues of the function.
+ * - @nsvr: Number of special variables records the function needs,
+ *   one for each of its scopes performing a regex match.
+ * - @svrup: For each record, the index of the record of the
+ *   nearest enclosing scope performing a match, SVR_NOUP if none.
+ * - @flags: Properties found by the compiler, see 'FN_*'.
  */
 
 #define is_fn(v)  check_type(v, O_FN)
 
+/*
+ * FN_SHORT: The function has no loop and only calls builtins that
+ * cannot block, it's cheap enough to be run inline e.g as the
+ * continuation of a Work.
+ */
+#define FN_SHORT  (0b1 << 0)
+
+/*
+ * FN_PURE: The function only reads its arguments, locals and
+ * upvalues, it writes no upvalue, global or argument and does no
+ * I/O, so it can run in parallel on elements of an Array while the
+ * caller is parked, see 'ma_array.h' and "Escape Analysis of
+ * Captured Lexicals" in 'docs/concurrency.md'.
+ */
+#define FN_PURE   (0b1 << 1)
+
+/*
+ * FN_STATE: The function declares static lexicals ('state'), each
+ * of its closures keeps their values in its own @state.
+ */
+#define FN_STATE  (0b1 << 2)
+
+/* No enclosing matching scope, see @svrup. */
+#define SVR_NOUP  0xFF
+
 typedef struct Fn {
    Header;
    UByte arity;
+   UByte nuv;
+   UByte nsvr;
+   UByte flags;
    size_t ns;
    CodeBuf code;
    ValueBuf cons;
+   UVDesc *uvd;
+   UByte *svrup;
 } Fn;
 
 /* @@@Repr of upvalues. */
@@ -462,7 +633,24 @@ typedef struct Upval {
    Upvalfields;
 } Upval;
 
-/* @@SUpval: Repr of shared upvalues */
+/*
+ * @@SUpval: Repr of shared upvalues. A closure only gets one when
+ * @shr of the @@UVDesc of the captured lexical is set, every
+ * other capture is a plain @@Upval accessed without any atomic.
+ *
+ * A shared upvalue is closed (boxed) as soon as it is created: the
+ * lexical is moved into @state.val, @p points to it and the
+ * declaring function accesses the lexical through the box too. It
+ * is never on the @ouv list of a state thus a stack reallocation
+ * never rewrites @p while another maatine reads it.
+ *
+ * - @seq: Sequence counter of the seqlock guarding @p, odd while
+ *   a writer is in. Readers retry until they see the same even
+ *   value before and after loading the value.
+ * - @lock: Parking mutex held by writers and by read-modify-write
+ *   sequences (e.g 'x = x + 1' in a 'ma for') from the READ up to
+ *   the WRITE, see 'docs/concurrency.md'.
+ */
 #define O_VSUPVAL  vary(O_UPVAL, 1)
 
 /* UVs aren't first class values! these are utils for syncing ops. */
@@ -472,9 +660,78 @@ typedef struct Upval {
 typedef struct SUpval {
    Header;
    Upvalfields;
-   /* TODO: librs fields */
+   AO_t seq;
+   AO_TS_t lock;
 } SUpval;
 
+/*
+ * Seqlock over a single Value, used by shared upvalues and shared
+ * global symbols. 'seq' is an AO_t, 'lock' an AO_TS_t and 'p'
+ * points to the guarded value.
+ *
+ * - sl_lock/sl_unlock: Writer/RMW lock, a parking mutex. A holder
+ *   may call, block or yield before releasing it so contenders do
+ *   not spin on it: after MA_SLSPIN failed attempts the maatine
+ *   'M' parks in 'ma_sl_park()' and other maatines run on its
+ *   thread meanwhile.
+ * - sl_read: Read '*p' into 'v', retried while a writer is in,
+ *   readers never write to the guarded cache line. The read
+ *   barrier keeps the load of '*p' from being reordered past the
+ *   second load of 'seq'.
+ * - sl_write: Store 'v' into '*p', the caller holds the lock. The
+ *   write barrier keeps the store to '*p' from being reordered
+ *   before the first increment of 'seq'.
+ */
+#define sl_lock(M, lock)                                 \
+   do {                                                  \
+      if (AO_test_and_set_acquire(&(lock)) == AO_TS_SET) \
+         ma_sl_park(M, &(lock));                         \
+   } while (0)
+
+#define sl_unlock(lock)  AO_CLEAR(&(lock))
+
+#define sl_read(seq, p, v)                               \
+   do {                                                  \
+      AO_t s_;                                           \
+      do {                                               \
+         while ((s_ = AO_load_acquire(&(seq))) & 1);     \
+         (v) = *(p);                                     \
+         AO_nop_read();                                  \
+      } while (AO_load(&(seq)) != s_);                   \
+   } while (0)
+
+#define sl_write(seq, p, v)                              \
+   do {                                                  \
+      AO_fetch_and_add1(&(seq));                         \
+      AO_nop_write();                                    \
+      *(p) = (v);                                        \
+      AO_fetch_and_add1_release(&(seq));                 \
+   } while (0)
+
+/*
+ * Slow path of 'sl_lock()', retries 'lock' MA_SLSPIN times then
+ * parks 'M' at the tail of its scheduler queue and retries once it
+ * is picked again, until the lock is taken.
+ */
+struct Maa;
+
+MA_IFUNC void ma_sl_park(struct Maa *M, AO_TS_t *lock);
+
+/* Sync ops on the shared upvalue 'uv'. */
+#define suv_lock(M, uv)      sl_lock(M, (uv)->lock)
+#define suv_unlock(uv)       sl_unlock((uv)->lock)
+#define suv_read(uv, v)      sl_read((uv)->seq, (uv)->p, v)
+#define suv_write(uv, v)     sl_write((uv)->seq, (uv)->p, v)
+
+/* Read into 'v' the upvalue 'uv' whose description is 'd'. */
+#define uv_read(d, uv, v)                  \
+   do {                                    \
+      if (ma_unlikely((d)->shr))           \
+         suv_read(as_vsupval(uv), v);      \
+      else                                 \
+         (v) = *(uv)->p;                   \
+   } while (0)
+
 /*
  * @@Closure: A closure is a variant of a function which keep
  * tracks of its upvalues and this is why we'll not use @@Fn 
@@ -666,15 +923,53 @@ typedef struct FIns {
    Value fvalue;
 } FIns;
 
+/*
+ * @@GSlot: Slot of a global symbol of a namespace.
+ *
+ * - @val: The value of the global symbol.
+ * - @shr: Is '1' if the slot goes through the seqlock, plainly
+ *   loaded and stored otherwise. The compiler flags a slot as a
+ *   candidate when a function that may run in another maatine
+ *   (see "Escape Analysis" in 'docs/concurrency.md') reads or
+ *   writes it, no access tracks which maatine touches a slot.
+ *   While a single OS thread runs maat code @shr stays '0'; the
+ *   scheduler sets it on every candidate in the stop-the-world
+ *   safepoint where it starts its second thread, and candidates
+ *   linked afterwards get it set in the safepoint that grows @gs
+ *   of their namespace. It never changes while another thread may
+ *   be accessing the slot.
+ * - @cand: Is '1' if the compiler flagged the slot as a candidate.
+ * - @seq, @lock: Seqlock of the slot, see 'sl_read()'.
+ */
+typedef struct GSlot {
+   Value val;
+   UByte cand;
+   UByte shr;
+   AO_t seq;
+   AO_TS_t lock;
+} GSlot;
+
 /*
  * @@Namespace: Repr of a namespace e.g 'FOO::BAR'. A namespace
  * can either be represented as a package, role or (c)class.
  * 'FOO::BAR::x()' is a call to the function 'x' in 'FOO::BAR'
  * if ever there is.
  *
- * - @ours: Stores the namespace's global symbols, 'x' is a
- *   global symbol in package namespace 'FOO::BAR' and it can
- *   be fully qualified as in the above call.
+ * - @ours: Maps the names of the namespace's global symbols to
+ *   their index in @gs, 'x' is a global symbol in package
+ *   namespace 'FOO::BAR' and it can be fully qualified as in the
+ *   above call. Just like namespaces, globals are resolved at
+ *   compile time so @ours is only used by the compiler, for
+ *   reflection and for @exports.
+ * - @gs: Flat buffer of the global symbols, 'FOO::BAR::x' is an
+ *   indexed load from the @gs of 'FOO::BAR'. Code loaded at
+ *   runtime may add globals to a namespace, @gs is then grown by
+ *   reallocation. While a single OS thread runs maat code that's
+ *   done in place; otherwise it's only done in a stop-the-world
+ *   safepoint, the same in which the new slots get their @shr, so
+ *   no thread is ever in 'gs_read()'/'gs_write()' on the old
+ *   buffer when it's freed.
+ * - @gsize: Number of slots in @gs.
  *
  * @ours of the package 'main::' takes care of the following
  * type I & II special variables:
@@ -710,10 +1005,34 @@ typedef struct FIns {
 typedef struct Namespace {
    Header;
    Map *ours;
+   GSlot *gs;
+   UInt gsize;
    ExportBuf export;
    Value val;
 } Namespace;
 
+/* Read/write global 'i' of namespace 'ns', see @@GSlot. */
+#define gs_read(ns, i, v)                                   \
+   do {                                                     \
+      GSlot *g_ = &(ns)->gs[i];                             \
+      if (ma_likely(!g_->shr))                              \
+         (v) = g_->val;                                     \
+      else                                                  \
+         sl_read(g_->seq, &g_->val, v);                     \
+   } while (0)
+
+#define gs_write(M, ns, i, v)                               \
+   do {                                                     \
+      GSlot *g_ = &(ns)->gs[i];                             \
+      if (ma_likely(!g_->shr))                              \
+         g_->val = (v);                                     \
+      else {                                                \
+         sl_lock(M, g_->lock);                              \
+         sl_write(g_->seq, &g_->val, v);                    \
+         sl_unlock(g_->lock);                               \
+      }                                                     \
+   } while (0)
+
 /* @@@Definition of below objects are in their respective '.h' files. */
 
 /* A thread-safe channel and scheduler ring buffer queue. */
@@ -726,10 +1045,12 @@ typedef struct Namespace {
 /* @@State object, see 'ma_state.h'. */
 #define O_VSTATE  vary(O_STATE, 0)
 #define O_VCO     vary(O_STATE, 1)
+#define O_VGFUN   vary(O_STATE, 2)
 
 #define is_state(v)   check_type(v, O_STATE)
 #define iss_state(v)  check_rtype(v, ctb(O_VSTATE))
 #define is_co(c)      check_rtype(v, ctb(O_VCO))
+#define is_gfun(v)    check_rtype(v, ctb(O_VGFUN))
 
 #define as_state(v)  (ma_assert(is_state(v)), cast(State *, as_gcobj(v)))
 #define as_co(v)     as_state(v)
@@ -740,6 +1061,12 @@ typedef struct Namespace {
 #define is_work(v)  check_rtype(v, ctb(O_VWORK))
 #define as_work(v)  (ma_assert(is_state(v)), cast(Work *, as_gcobj(v)))
 
+/* @@Regex object, see 'ma_regex.h'. */
+#define O_VREGEX  vary(O_REGEX, 0)
+
+#define is_regex(v)  check_rtype(v, ctb(O_VREGEX))
+#define as_regex(v)  (ma_assert(is_regex(v)), cast(Regex *, as_gcobj(v)))
+
 /* @@Maatine object, see 'ma_maa.h'. */
 #define O_VMAA  vary(O_MAA, 0)
 
@@ -769,6 +1096,7 @@ typedef struct Namespace {
 #define gco2wk(o)    (ma_assert(check_rtype(o, O_VWORK)), &(ounion(o)->wk))
 #define gco2rbq(o)   (ma_assert(check_rtype(o, O_VRBQ)), &(ounion(o)->rbq))
 #define gco2ns(o)    (ma_assert(check_rtype(o, O_VNS)), &(ounion(o)->ns))
+#define gco2rx(o)    (ma_assert(check_rtype(o, O_VREGEX)), &(ounion(o)->rx))
 
 /* The other way around. */
 #define x2gco(x)  (ma_assert(is_ctb(x)), &(ounion(x)->gc_obj))
@@ -791,16 +1119,20 @@ union OUnion {
    Ma ma;
    Work wk;
    Namespace ns;
+   Regex rx;
 } OUnion;
 
 /* It's on its own as it's needed at 'ma_str.c' and elsewhere. */
 #define sunion_of(s)  cast(Sunion *, s)
 #define a2u8(s)       (ma_assert(check_type(s, O_STR)), &(sunion_of(s)->as))
 #define u82a(s)       (ma_assert(check_type(s, O_U8STR)), &(sunion_of(s)->u8s))
+#define s2slc(s)      (ma_assert(check_rtype(s, O_VLNGSTR) && ((s)->sl & STR_SLCBIT)), \
+                       &(sunion_of(s)->sls))
 
 union Sunion {
    Str as;
    U8Str u8s;
+   SlStr sls;
 } Sunion;
 
 #endif
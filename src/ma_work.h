@@ -3,21 +3,93 @@
 
 #include "ma_val.h"
 #include "ma_state.h"
+#include "ma_timer.h"
 
 /* ##The Work object.
  *
- * #state: State of the work.
- * #then_size: Size of the list of .then({}) of this Work.
- * #then: List of thens.
- * #catch: Exception handler if an exception is thrown;
+ * #state: State of the work, one of 'WK_*'.
+ * #wk_code: The code of the work, for a work created by '.then'
+ * or '.catch' it's the closure passed to it.
+ * #on: For a dependent, the states of the work it depends on that
+ * run #wk_code, see 'WK_ON*'. In any other state the dependent
+ * completes right away with the same state and result, so every
+ * '.catch' registered on a work, or further down a chain of
+ * '.then', sees the exception.
+ * #result: Result of the work once Done.
+ * #tm: Timer of the work if it waits for a deadline, it's armed
+ * in the timing wheel of the MVM the arming maatine runs on and
+ * kept alive by the collector of the owner of the work, see
+ * 'ma_timer.h'.
+ * #lock: Spinlock taken with 'wk_lock()' to register a dependent
+ * and to complete the work, so a '.then' racing with the
+ * completion is either run by the completion or, if it comes
+ * after, right at registration.
+ * #pending: For a work returned by 'Work.allof' or built by
+ * 'abide', the number of works it still waits for. Each of them
+ * has this work as a dependent and decrements the counter when it
+ * completes, the last one completes this work.
+ * #ndeps: Number of dependents, the first MA_WKDEPS are in #deps
+ * and the rest in #xdeps which is only allocated when needed.
+ * #xcap: Capacity of #xdeps.
+ * #tnext: Link in the trampoline of the completing maatine, see
+ * 'ma_wk_complete()'.
+ * #deps: Works created by '.then' or '.catch' on this work or
+ * waiting for it.
  */
 typedef struct Work {
    Header;
+   Timer tm;
    UByte state;
-   UByte then_size;
+   UByte on;
+   UInt ndeps;
+   UInt xcap;
    Closure *wk_code;
-   Closure *then;
-   Closure *catch[1];
+   Value result;
+   AO_TS_t lock;
+   AO_t pending;
+   struct Work **xdeps;
+   struct Work *tnext;
+   struct Work *deps[MA_WKDEPS];
 } Work;
 
+#define wk_lock(w)    while (AO_test_and_set_acquire(&(w)->lock) == AO_TS_SET)
+#define wk_unlock(w)  AO_CLEAR(&(w)->lock)
+
+#define WK_DO      0
+#define WK_DONE    1
+#define WK_FAILED  2
+
+/* States running the code of a dependent, '.then' and '.catch'. */
+#define WK_ONDONE  (0b1 << WK_DONE)
+#define WK_ONFAIL  (0b1 << WK_FAILED)
+
+#define wk_runs(d, state)  ((d)->on & (0b1 << (state)))
+
+/* Dependent 'i' of work 'w'. */
+#define wk_dep(w, i)  ((i) < MA_WKDEPS ? (w)->deps[i] : (w)->xdeps[(i) - MA_WKDEPS])
+
+/*
+ * A dependent whose code is short (see FN_SHORT) runs right away on
+ * the maatine completing the work it depends on instead of getting
+ * a maatine of its own.
+ */
+#define wk_inline(w)  ((w)->wk_code != NULL && ((w)->wk_code->fn->flags & FN_SHORT))
+
+/* Register 'd' as a dependent of 'w', run it if 'w' is completed. */
+MA_IFUNC void ma_wk_depend(struct Maa *m, Work *w, Work *d);
+
+/*
+ * Complete 'w' in 'state' with 'res' from maatine 'm' then go
+ * through its dependents: counters of 'allof' works are
+ * decremented, dependents not run in 'state' complete with it,
+ * short dependents are run inline and the others are scheduled.
+ *
+ * Inline dependents are trampolined rather than run recursively:
+ * a call made while 'm' is already completing a work only pushes
+ * the work onto @wk_tramp of 'm' and returns, the outermost call
+ * drains it. A chain of short continuations thus runs in constant
+ * C stack however long it is.
+ */
+MA_IFUNC void ma_wk_complete(struct Maa *m, Work *w, UByte state, Value res);
+
 #endif
@@ -21,6 +21,67 @@
 #define MA_COPYRIGHT  "Maat " MA_PATCH  " Copyright (C) 2023 Maat.cm, PanLab.africa"
 #define MA_AUTHORS    "Kueppo Tcheukam J. W."
 
+#include <stddef.h>
+
+#include "ma_conf.h"
+
+struct Maa;
+struct Value;
+
+/*
+ * $$Bulk construction and export of Arrays and Maps.
+ *
+ * Unlike building values one by one through the virtual stack, these
+ * don't push anything: the target is sized once, elements are written
+ * straight into its buffer and a single GC barrier is done per call,
+ * see "Bulk Builders" in 'docs/api.md'. The Array or Map 'v' must
+ * be owned by 'm'. The barrier is the backward one (the target is
+ * grayed or touched) and it's done before the first element is
+ * stored. Importers allocating per element, like 'ma_arr_strs()',
+ * may run GC steps in between that blacken the target again, so
+ * the target is also anchored in the @tmproots of 'm' for the whole
+ * call: roots are rescanned in the atomic phase and by every minor
+ * collection, so elements stored after a step are still found.
+ */
+
+/* Return in 'v' a new Array of capacity 'n' / Map sized for 'n' keys. */
+MA_API void ma_newarray(struct Maa *m, struct Value *v, size_t n);
+MA_API void ma_newmap(struct Maa *m, struct Value *v, size_t n);
+
+/* Append 'n' numbers / 'n' strings of lengths 'lens' to Array 'v'. */
+MA_API void ma_arr_nums(struct Maa *m, struct Value *v, const double *nums, size_t n);
+MA_API void ma_arr_strs(struct Maa *m, struct Value *v, const char *const *strs,
+                        const size_t *lens, size_t n);
+
+/* Append the 'n' values of 'vals' to Array 'v'. */
+MA_API void ma_arr_vals(struct Maa *m, struct Value *v, const struct Value *vals, size_t n);
+
+/* Set the 'n' pairs 'keys[i] => vals[i]' in Map 'v'. */
+MA_API void ma_map_kvs(struct Maa *m, struct Value *v, const struct Value *keys,
+                       const struct Value *vals, size_t n);
+
+/*
+ * Same as 'ma_map_kvs()' with keys from C: strings 'keys[i]' of
+ * lengths 'lens[i]' / numbers 'keys[i]'.
+ */
+MA_API void ma_map_skvs(struct Maa *m, struct Value *v, const char *const *keys,
+                        const size_t *lens, const struct Value *vals, size_t n);
+MA_API void ma_map_nkvs(struct Maa *m, struct Value *v, const double *keys,
+                        const struct Value *vals, size_t n);
+
+/*
+ * Copy up to 'n' elements of Array 'v' from index 'from' into the
+ * C buffer 'out', return how many were copied or -1 if one of them
+ * isn't a number / a string. Exported strings point into the Maat
+ * strings, they're only valid until 'm' next allocates or runs a
+ * GC step, or 'v' is modified, whichever comes first. Copy them
+ * before calling back into Maat.
+ */
+MA_API long ma_arr_tonums(struct Maa *m, const struct Value *v, size_t from,
+                          double *out, size_t n);
+MA_API long ma_arr_tostrs(struct Maa *m, const struct Value *v, size_t from,
+                          const char **out, size_t *lens, size_t n);
+
 
 
 #endif